@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+
+// 测量包含 print.h / debugger.h / demangle.h 的翻译单元的编译时间和目标文件大小
+// 每个用例生成一个源文件，对 kTypes 个互不相同的类型各调用一次，编译 kRepeat 次取最快的一次
+// 编译器和头文件目录由 CMake 通过宏传进来，测的是与本项目相同的编译器
+constexpr int kTypes = 40;
+constexpr int kRepeat = 3;
+
+namespace fs = std::filesystem;
+
+// 每个 K 都是一个新类型，容器嵌套让 print 的各种分派都实例化一遍
+std::string prelude() {
+    return "template<int K> struct tag {\n"
+           "    friend std::ostream &operator<<(std::ostream &os, tag) { return os << K; }\n"
+           "};\n"
+           "template<int K> using nested = std::map<std::string, std::vector<std::tuple<tag<K>, std::optional<int>,"
+           " std::variant<int, double>>>>;\n";
+}
+
+std::string repeat(std::string const &line) {
+    std::string body;
+    for (int k = 0; k < kTypes; ++k) {
+        std::string code = line;
+        for (std::size_t pos; (pos = code.find('K')) != std::string::npos;)
+            code.replace(pos, 1, std::to_string(k));
+        body += "    " + code + "\n";
+    }
+    return body;
+}
+
+struct Case {
+    char const *name;
+    std::string source;
+};
+
+void measure(fs::path const &dir, Case const &c, char const *flags) {
+    fs::path source = dir / (std::string(c.name) + ".cpp");
+    fs::path object = dir / (std::string(c.name) + ".o");
+    std::ofstream(source) << c.source;
+    std::string command = std::string(BENCH_CXX_COMPILER) + " -std=c++20 " + flags + " " + BENCH_INCLUDE_DIRS +
+                          " -c " + source.string() + " -o " + object.string();
+    double best = 1e300;
+    for (int i = 0; i < kRepeat; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        if (std::system(command.c_str()) != 0) {
+            std::printf("%-16s %-4s compile failed: %s\n", c.name, flags, command.c_str());
+            return;
+        }
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::printf("%-16s %-4s %8.0f ms %9ju bytes\n", c.name, flags, best, std::uintmax_t(fs::file_size(object)));
+}
+
+// 可以在命令行上指定只跑哪些用例，例如 bench_compile print debug
+int main(int argc, char **argv) {
+    fs::path dir = fs::temp_directory_path() / ("bench_compile_" + std::to_string(::getpid()));
+    fs::create_directories(dir);
+    std::string containers = "#include <map>\n#include <optional>\n#include <string>\n#include <tuple>\n"
+                             "#include <variant>\n#include <vector>\n#include <iostream>\n";
+    Case cases[] = {
+        {"empty", "int main() {}\n"},
+        {"print-include", "#include <print.h>\nint main() {}\n"},
+        {"print", containers + "#include <print.h>\n" + prelude() + "int main() {\n" + repeat("print(nested<K>{}, tag<K>{});") + "}\n"},
+        {"to_string", containers + "#include <print.h>\n" + prelude() + "int main() {\n" +
+                      repeat("(void) to_string(nested<K>{});") + "}\n"},
+        {"debugger-include", "#include <debugger.h>\nint main() {}\n"},
+        {"debug", containers + "#include <debugger.h>\n" + prelude() + "int main() {\n" +
+                  repeat("debug(), nested<K>{}, tag<K>{};") + "}\n"},
+        {"demangle", containers + "#include <demangle.h>\n" + prelude() + "int main() {\n" +
+                     repeat("(void) demangle<nested<K>>();") + "}\n"},
+    };
+    for (auto const &c: cases) {
+        if (argc > 1 && std::find_if(argv + 1, argv + argc, [&](char const *arg) {
+                return std::string_view(arg) == c.name;
+            }) == argv + argc)
+            continue;
+        measure(dir, c, "-O0");
+        measure(dir, c, "-O2");
+    }
+    fs::remove_all(dir);
+}
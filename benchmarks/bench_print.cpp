@@ -0,0 +1,341 @@
+#include <print.h>
+#include <print_json.h>
+#include <debugger.h>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <map>
+#include <string>
+#include <unistd.h>
+#include <variant>
+#include <vector>
+
+// print、to_string、debug() 与 printf、std::format、直接 write 的吞吐量对比，结果以 JSON 输出到标准输出
+// 测量期间标准输出和标准错误都重定向到 /dev/null，测的是格式化加一次系统调用的开销，与终端无关
+// MB/s 按 print 格式的输出字节数计算，各方法输出的内容基本相同（debug() 还多了文件名和行号）
+constexpr std::size_t kScalars = 200'000;
+constexpr std::size_t kMaps = 50'000;
+constexpr std::size_t kVector = 1'000'000;
+constexpr std::size_t kVectorRepeat = 5;
+
+using Nested = std::map<std::string, std::variant<int, double> >;
+
+struct Result {
+    std::string method;
+    double ns;
+};
+
+// 把 fd 1 和 2 临时指向 /dev/null，析构时恢复
+class Silence {
+public:
+    Silence() : mNull(::open("/dev/null", O_WRONLY)), mOut(::dup(1)), mErr(::dup(2)) {
+        std::fflush(stdout);
+        ::dup2(mNull, 1);
+        ::dup2(mNull, 2);
+    }
+
+    Silence(Silence &&) = delete;
+
+    ~Silence() {
+        std::fflush(stdout);
+        ::dup2(mOut, 1);
+        ::dup2(mErr, 2);
+        ::close(mOut);
+        ::close(mErr);
+        ::close(mNull);
+    }
+
+private:
+    int mNull, mOut, mErr;
+};
+
+template <class F>
+double timeIt(F &&f) {
+    Silence silence;
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+void writeAll(char const *p, std::size_t n) {
+    while (n != 0) {
+        ssize_t written = ::write(1, p, n);
+        if (written <= 0)
+            return;
+        p += written;
+        n -= std::size_t(written);
+    }
+}
+
+// 一种数据在各方法下的耗时；elements 是总元素数，bytes 是 print 格式的总输出字节数
+struct Case {
+    char const *name;
+    std::size_t elements;
+    std::size_t bytes;
+    std::vector<Result> results;
+
+    template <class F>
+    void run(char const *method, F &&f) {
+        results.push_back({method, timeIt(f)});
+    }
+};
+
+std::vector<std::map<std::string, std::variant<std::string, double, std::size_t> > > report;
+
+void record(Case const &c) {
+    for (auto const &r: c.results) {
+        report.push_back({
+            {"case", c.name},
+            {"method", r.method},
+            {"elements", c.elements},
+            {"bytes", c.bytes},
+            {"ns_per_element", r.ns / double(c.elements)},
+            {"mb_per_s", double(c.bytes) / 1e6 / (r.ns / 1e9)},
+        });
+    }
+}
+
+void benchInts() {
+    Case c{"int", kScalars, 0, {}};
+    for (std::size_t i = 0; i < kScalars; ++i)
+        c.bytes += to_string(int(i * 7919)).size() + 1;
+    c.run("print", [] {
+        for (std::size_t i = 0; i < kScalars; ++i)
+            print(int(i * 7919));
+    });
+    c.run("to_string", [] {
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < kScalars; ++i)
+            total += to_string(int(i * 7919)).size();
+        if (total == 0)
+            std::abort();
+    });
+    c.run("debug", [] {
+        for (std::size_t i = 0; i < kScalars; ++i)
+            debug(), int(i * 7919);
+    });
+    c.run("printf", [] {
+        for (std::size_t i = 0; i < kScalars; ++i)
+            std::printf("%d\n", int(i * 7919));
+    });
+#if defined(__cpp_lib_format)
+    c.run("std::format", [] {
+        for (std::size_t i = 0; i < kScalars; ++i) {
+            auto s = std::format("{}\n", int(i * 7919));
+            writeAll(s.data(), s.size());
+        }
+    });
+#endif
+    c.run("write", [] {
+        char buf[32];
+        for (std::size_t i = 0; i < kScalars; ++i) {
+            char *end = std::to_chars(buf, buf + sizeof(buf), int(i * 7919)).ptr;
+            *end++ = '\n';
+            writeAll(buf, std::size_t(end - buf));
+        }
+    });
+    record(c);
+}
+
+void benchDoubles() {
+    Case c{"double", kScalars, 0, {}};
+    auto value = [](std::size_t i) { return double(i) * 1.0001 + 0.5; };
+    for (std::size_t i = 0; i < kScalars; ++i)
+        c.bytes += to_string(value(i)).size() + 1;
+    c.run("print", [&] {
+        for (std::size_t i = 0; i < kScalars; ++i)
+            print(value(i));
+    });
+    c.run("to_string", [&] {
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < kScalars; ++i)
+            total += to_string(value(i)).size();
+        if (total == 0)
+            std::abort();
+    });
+    c.run("debug", [&] {
+        for (std::size_t i = 0; i < kScalars; ++i)
+            debug(), value(i);
+    });
+    c.run("printf", [&] {
+        for (std::size_t i = 0; i < kScalars; ++i)
+            std::printf("%g\n", value(i));
+    });
+#if defined(__cpp_lib_format)
+    c.run("std::format", [&] {
+        for (std::size_t i = 0; i < kScalars; ++i) {
+            auto s = std::format("{:g}\n", value(i));
+            writeAll(s.data(), s.size());
+        }
+    });
+#endif
+    c.run("write", [&] {
+        char buf[64];
+        for (std::size_t i = 0; i < kScalars; ++i) {
+            char *end = std::to_chars(buf, buf + sizeof(buf), value(i), std::chars_format::general, 6).ptr;
+            *end++ = '\n';
+            writeAll(buf, std::size_t(end - buf));
+        }
+    });
+    record(c);
+}
+
+void benchStrings() {
+    std::vector<std::string> strings;
+    for (std::size_t i = 0; i < 1024; ++i)
+        strings.push_back("string number " + std::to_string(i * 31));
+    Case c{"string", kScalars, 0, {}};
+    for (std::size_t i = 0; i < kScalars; ++i)
+        c.bytes += strings[i % strings.size()].size() + 1;
+    c.run("print", [&] {
+        for (std::size_t i = 0; i < kScalars; ++i)
+            print(strings[i % strings.size()]);
+    });
+    c.run("to_string", [&] {
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < kScalars; ++i)
+            total += to_string(strings[i % strings.size()]).size();
+        if (total == 0)
+            std::abort();
+    });
+    c.run("debug", [&] {
+        for (std::size_t i = 0; i < kScalars; ++i)
+            debug(), strings[i % strings.size()];
+    });
+    c.run("printf", [&] {
+        for (std::size_t i = 0; i < kScalars; ++i)
+            std::printf("%s\n", strings[i % strings.size()].c_str());
+    });
+#if defined(__cpp_lib_format)
+    c.run("std::format", [&] {
+        for (std::size_t i = 0; i < kScalars; ++i) {
+            auto s = std::format("{}\n", strings[i % strings.size()]);
+            writeAll(s.data(), s.size());
+        }
+    });
+#endif
+    c.run("write", [&] {
+        std::string line;
+        for (std::size_t i = 0; i < kScalars; ++i) {
+            line = strings[i % strings.size()];
+            line += '\n';
+            writeAll(line.data(), line.size());
+        }
+    });
+    record(c);
+}
+
+// 与 tests/test_print.cpp 里相同的 map<string, variant<int, double>>，每次调用打印一整个 map
+void benchNested() {
+    Nested m{{"hello", 2.1}, {"world", 4}, {"ok", 0}};
+    Case c{"nested_map", kMaps * m.size(), (to_string(m).size() + 1) * kMaps, {}};
+    c.run("print", [&] {
+        for (std::size_t i = 0; i < kMaps; ++i)
+            print(m);
+    });
+    c.run("to_string", [&] {
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < kMaps; ++i)
+            total += to_string(m).size();
+        if (total == 0)
+            std::abort();
+    });
+    c.run("debug", [&] {
+        for (std::size_t i = 0; i < kMaps; ++i)
+            debug(), m;
+    });
+    c.run("printf", [&] {
+        for (std::size_t i = 0; i < kMaps; ++i) {
+            std::printf("{");
+            bool once = false;
+            for (auto const &[k, v]: m) {
+                std::printf(once ? ", %s: " : "%s: ", k.c_str());
+                once = true;
+                if (auto p = std::get_if<int>(&v))
+                    std::printf("%d", *p);
+                else
+                    std::printf("%g", std::get<double>(v));
+            }
+            std::printf("}\n");
+        }
+    });
+#if defined(__cpp_lib_format)
+    c.run("std::format", [&] {
+        for (std::size_t i = 0; i < kMaps; ++i) {
+            auto s = std::format("{}\n", printable(m));
+            writeAll(s.data(), s.size());
+        }
+    });
+#endif
+    c.run("write", [&] {
+        std::string line = to_string(m) + '\n';
+        for (std::size_t i = 0; i < kMaps; ++i)
+            writeAll(line.data(), line.size());
+    });
+    record(c);
+}
+
+// 一次调用打印一个很大的 vector，测的是容器遍历和整行缓冲区的增长
+void benchVector() {
+    std::vector<int> v(kVector);
+    for (std::size_t i = 0; i < kVector; ++i)
+        v[i] = int(i * 7919 % 1000003);
+    Case c{"large_vector", kVector * kVectorRepeat, (to_string(v).size() + 1) * kVectorRepeat, {}};
+    c.run("print", [&] {
+        for (std::size_t r = 0; r < kVectorRepeat; ++r)
+            print(v);
+    });
+    c.run("to_string", [&] {
+        std::size_t total = 0;
+        for (std::size_t r = 0; r < kVectorRepeat; ++r)
+            total += to_string(v).size();
+        if (total == 0)
+            std::abort();
+    });
+    c.run("debug", [&] {
+        for (std::size_t r = 0; r < kVectorRepeat; ++r)
+            debug(), v;
+    });
+    c.run("printf", [&] {
+        for (std::size_t r = 0; r < kVectorRepeat; ++r) {
+            std::printf("[");
+            for (std::size_t i = 0; i < v.size(); ++i)
+                std::printf(i == 0 ? "%d" : ", %d", v[i]);
+            std::printf("]\n");
+        }
+    });
+#if defined(__cpp_lib_format)
+    c.run("std::format", [&] {
+        for (std::size_t r = 0; r < kVectorRepeat; ++r) {
+            auto s = std::format("{}\n", printable(v));
+            writeAll(s.data(), s.size());
+        }
+    });
+#endif
+    c.run("write", [&] {
+        std::string line;
+        for (std::size_t r = 0; r < kVectorRepeat; ++r) {
+            line.clear();
+            line += '[';
+            char buf[16];
+            for (std::size_t i = 0; i < v.size(); ++i) {
+                if (i != 0)
+                    line += ", ";
+                line.append(buf, std::to_chars(buf, buf + sizeof(buf), v[i]).ptr);
+            }
+            line += "]\n";
+            writeAll(line.data(), line.size());
+        }
+    });
+    record(c);
+}
+
+int main() {
+    benchInts();
+    benchDoubles();
+    benchStrings();
+    benchNested();
+    benchVector();
+    print_json(report);
+}
@@ -0,0 +1,112 @@
+#include <rbtree.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <ranges>
+#include <vector>
+#include "perf_counter.h"
+
+// 比较三种节点布局在 100 万节点下的内存占用、耗时和缓存未命中
+constexpr std::size_t kNodes = 1'000'000;
+
+template <class Policy>
+struct Node : RbTree<Node<Policy>, std::less<>, Policy>::RbNode {
+    std::uint64_t mKey;
+
+    friend bool operator<(Node const &lhs, Node const &rhs) noexcept {
+        return lhs.mKey < rhs.mKey;
+    }
+
+    friend bool operator<(Node const &lhs, std::uint64_t rhs) noexcept {
+        return lhs.mKey < rhs;
+    }
+
+    friend bool operator<(std::uint64_t lhs, Node const &rhs) noexcept {
+        return lhs < rhs.mKey;
+    }
+};
+
+template <class F>
+void measure(char const *policy, char const *phase, std::size_t ops, F &&func) {
+    PerfCounter misses;
+    auto start = std::chrono::steady_clock::now();
+    misses.start();
+    func();
+    auto count = misses.stop();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    if (count)
+        std::printf("%-8s %-8s %8.1f ns/op %10.3f misses/op\n", policy, phase,
+                    elapsed.count() / double(ops), double(*count) / double(ops));
+    else
+        std::printf("%-8s %-8s %8.1f ns/op %10s misses/op\n", policy, phase,
+                    elapsed.count() / double(ops), "n/a");
+}
+
+template <class Policy>
+void run(char const *policy) {
+    using Tree = RbTree<Node<Policy>, std::less<>, Policy>;
+    std::mt19937_64 rng(42);
+    std::unique_ptr<Node<Policy>[]> nodes(new Node<Policy>[kNodes]);
+    std::vector<std::uint64_t> keys(kNodes);
+    for (std::size_t i = 0; i < kNodes; ++i)
+        keys[i] = nodes[i].mKey = rng();
+
+    std::printf("%-8s node %zu bytes, %.1f MiB for %zu nodes\n", policy, sizeof(Node<Policy>),
+                double(sizeof(Node<Policy>) * kNodes) / (1 << 20), kNodes);
+
+    Tree tree;
+    measure(policy, "insert", kNodes, [&] {
+        for (std::size_t i = 0; i < kNodes; ++i)
+            tree.insert(nodes[i]);
+    });
+
+    std::shuffle(keys.begin(), keys.end(), rng);
+    std::size_t found = 0;
+    measure(policy, "find", kNodes, [&] {
+        for (auto key: keys)
+            found += tree.find(key) != tree.end();
+    });
+
+    std::uint64_t sum = 0;
+    measure(policy, "iterate", kNodes, [&] {
+        for (auto &node: tree)
+            sum += node.mKey;
+    });
+
+    measure(policy, "pop", kNodes, [&] {
+        while (!tree.empty())
+            tree.erase(tree.front());
+    });
+
+    // 有序批量建树，对比上面逐个 insert
+    std::vector<Node<Policy> *> sorted(kNodes);
+    for (std::size_t i = 0; i < kNodes; ++i)
+        sorted[i] = &nodes[i];
+    std::sort(sorted.begin(), sorted.end(), [](auto *lhs, auto *rhs) { return *lhs < *rhs; });
+    measure(policy, "build", kNodes, [&] {
+        tree.insertSorted(sorted | std::views::transform([](auto *node) -> auto & { return *node; }));
+    });
+
+    // 一半元素同时到期：一次 split 拆下来，再从小树上逐个弹出
+    std::uint64_t median = sorted[kNodes / 2]->mKey;
+    measure(policy, "split", kNodes / 2, [&] {
+        Tree expired;
+        tree.split(median, expired);
+        while (!expired.empty())
+            expired.erase(expired.front());
+    });
+    while (!tree.empty())
+        tree.erase(tree.front());
+
+    if (found != kNodes || sum == 0)
+        std::printf("unexpected result\n");
+}
+
+int main() {
+    run<RbWideNode>("wide");
+    run<RbPackedNode>("packed");
+    run<RbCompactNode>("compact");
+}
@@ -0,0 +1,249 @@
+#include <rbtree.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+#include "perf_counter.h"
+
+// 侵入式 RbTree 与标准容器在定时器相关操作上的对比：
+// insert 建到 n 个元素，front 反复弹出最小值直到清空，erase 按随机顺序删除任意元素，
+// mixed 在 n 个活跃定时器上模拟插入、70% 取消、到期弹出的混合负载
+// std::priority_queue 不能删除任意元素，只能像常见的定时器实现那样打上取消标记、弹出时跳过
+constexpr std::size_t kMixedOps = 1'000'000;
+
+struct Entry : RbTree<Entry, std::less<Entry>, RbPackedNode>::RbNode {
+    std::uint64_t mKey{};
+    std::multiset<std::pair<std::uint64_t, std::size_t>>::iterator mSetIt{};
+    std::uint64_t mGeneration{};
+    bool mArmed{false};
+
+    friend bool operator<(Entry const &lhs, Entry const &rhs) noexcept {
+        return lhs.mKey < rhs.mKey;
+    }
+};
+
+struct RbAdapter {
+    static constexpr char const *kName = "rbtree";
+    static constexpr bool kCanErase = true;
+    RbTree<Entry, std::less<Entry>, RbPackedNode> mTree;
+    Entry *mEntries;
+
+    void insert(std::size_t index) {
+        mTree.insert(mEntries[index]);
+    }
+
+    void erase(std::size_t index) {
+        mTree.erase(mEntries[index]);
+    }
+
+    bool empty() const {
+        return mTree.empty();
+    }
+
+    std::uint64_t frontKey() {
+        return mTree.front().mKey;
+    }
+
+    std::size_t popFront() {
+        Entry &entry = mTree.front();
+        mTree.erase(entry);
+        return std::size_t(&entry - mEntries);
+    }
+};
+
+struct SetAdapter {
+    static constexpr char const *kName = "multiset";
+    static constexpr bool kCanErase = true;
+    std::multiset<std::pair<std::uint64_t, std::size_t>> mSet;
+    Entry *mEntries;
+
+    void insert(std::size_t index) {
+        mEntries[index].mSetIt = mSet.emplace(mEntries[index].mKey, index);
+    }
+
+    void erase(std::size_t index) {
+        mSet.erase(mEntries[index].mSetIt);
+    }
+
+    bool empty() const {
+        return mSet.empty();
+    }
+
+    std::uint64_t frontKey() {
+        return mSet.begin()->first;
+    }
+
+    std::size_t popFront() {
+        std::size_t index = mSet.begin()->second;
+        mSet.erase(mSet.begin());
+        return index;
+    }
+};
+
+// 堆里存 (key, index, generation)，取消只让 generation 过期，弹出时丢掉过期的项
+struct HeapAdapter {
+    static constexpr char const *kName = "priority_queue";
+    static constexpr bool kCanErase = false;
+
+    struct Item {
+        std::uint64_t mKey;
+        std::size_t mIndex;
+        std::uint64_t mGeneration;
+
+        bool operator>(Item const &that) const noexcept {
+            return mKey > that.mKey;
+        }
+    };
+
+    std::priority_queue<Item, std::vector<Item>, std::greater<>> mHeap;
+    Entry *mEntries;
+    std::size_t mLive{0};
+
+    void insert(std::size_t index) {
+        mHeap.push({mEntries[index].mKey, index, ++mEntries[index].mGeneration});
+        ++mLive;
+    }
+
+    void erase(std::size_t index) {
+        ++mEntries[index].mGeneration;
+        --mLive;
+    }
+
+    bool empty() const {
+        return mLive == 0;
+    }
+
+    std::uint64_t frontKey() {
+        skipStale();
+        return mHeap.top().mKey;
+    }
+
+    std::size_t popFront() {
+        skipStale();
+        std::size_t index = mHeap.top().mIndex;
+        mHeap.pop();
+        --mLive;
+        return index;
+    }
+
+    void skipStale() {
+        while (mHeap.top().mGeneration != mEntries[mHeap.top().mIndex].mGeneration)
+            mHeap.pop();
+    }
+};
+
+struct Measure {
+    PerfCounter mMisses;
+    std::chrono::steady_clock::time_point mStart;
+
+    void start() {
+        mStart = std::chrono::steady_clock::now();
+        mMisses.start();
+    }
+
+    void stop(char const *name, char const *workload, std::size_t n, std::size_t ops) {
+        auto count = mMisses.stop();
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - mStart;
+        std::printf("%-15s %-7s %8zu %8.1f ns/op", name, workload, n, elapsed.count() / double(ops));
+        if (count)
+            std::printf(" %8.3f misses/op\n", double(*count) / double(ops));
+        else
+            std::printf(" %8s misses/op\n", "n/a");
+    }
+};
+
+template <class Adapter>
+void run(std::size_t n) {
+    std::unique_ptr<Entry[]> entries(new Entry[n]);
+    std::mt19937_64 rng(42);
+    for (std::size_t i = 0; i < n; ++i)
+        entries[i].mKey = rng();
+    std::vector<std::size_t> order(n);
+    for (std::size_t i = 0; i < n; ++i)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), rng);
+    Measure measure;
+
+    {
+        Adapter adapter{};
+        adapter.mEntries = entries.get();
+        measure.start();
+        for (std::size_t i = 0; i < n; ++i)
+            adapter.insert(i);
+        measure.stop(Adapter::kName, "insert", n, n);
+
+        std::uint64_t checksum = 0;
+        measure.start();
+        while (!adapter.empty()) {
+            checksum += adapter.frontKey();
+            adapter.popFront();
+        }
+        measure.stop(Adapter::kName, "front", n, n);
+        if (checksum == 42)
+            std::printf("\n");
+    }
+
+    if constexpr (Adapter::kCanErase) {
+        Adapter adapter{};
+        adapter.mEntries = entries.get();
+        for (std::size_t i = 0; i < n; ++i)
+            adapter.insert(i);
+        measure.start();
+        for (std::size_t index: order)
+            adapter.erase(index);
+        measure.stop(Adapter::kName, "erase", n, n);
+    }
+
+    // 与 bench_timer_queue 相同的模型：到期时间大致递增，大部分定时器在到期前被取消
+    {
+        Adapter adapter{};
+        adapter.mEntries = entries.get();
+        std::vector<std::size_t> armed, slotOf(n), freeList(order.begin(), order.end());
+        auto disarm = [&](std::size_t index) {
+            entries[index].mArmed = false;
+            std::size_t slot = slotOf[index];
+            armed[slot] = armed.back();
+            slotOf[armed[slot]] = slot;
+            armed.pop_back();
+            freeList.push_back(index);
+        };
+        std::uint64_t now = 0;
+        measure.start();
+        for (std::size_t op = 0; op < kMixedOps; ++op) {
+            now += rng() % 4;
+            while (!adapter.empty() && adapter.frontKey() <= now)
+                disarm(adapter.popFront());
+            if (!armed.empty() && (freeList.empty() || rng() % 100 < 35)) {
+                std::size_t index = armed[rng() % armed.size()];
+                adapter.erase(index);
+                disarm(index);
+            } else {
+                std::size_t index = freeList.back();
+                freeList.pop_back();
+                entries[index].mKey = now + 1000 + rng() % (n * 4);
+                entries[index].mArmed = true;
+                slotOf[index] = armed.size();
+                armed.push_back(index);
+                adapter.insert(index);
+            }
+        }
+        measure.stop(Adapter::kName, "mixed", n, kMixedOps);
+        for (std::size_t index: std::vector(armed))
+            adapter.erase(index);
+    }
+}
+
+int main() {
+    for (std::size_t n: {1'000, 64'000, 1'000'000}) {
+        run<RbAdapter>(n);
+        run<SetAdapter>(n);
+        run<HeapAdapter>(n);
+    }
+}
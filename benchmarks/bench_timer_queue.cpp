@@ -0,0 +1,115 @@
+#include <rbtree.h>
+#include <pairing_heap.h>
+#include <dary_heap.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+#include "perf_counter.h"
+
+// 模拟 Loop 的定时器负载：到期时间大致递增（当前时间加一个随机延迟），
+// 大部分定时器在到期前被取消（超时保护的正常完成），其余的按时弹出
+constexpr std::size_t kOps = 2'000'000;
+constexpr std::size_t kLive = 1 << 16;
+constexpr unsigned kCancelPercent = 70;
+
+template <template <class> class Container>
+struct Timer : Container<Timer<Container>>::Node {
+    std::uint64_t mExpireTime{};
+    bool mArmed{false};
+
+    friend bool operator<(Timer const &lhs, Timer const &rhs) noexcept {
+        return lhs.mExpireTime < rhs.mExpireTime;
+    }
+};
+
+template <class T>
+using RbPacked = RbTree<T, std::less<T>, RbPackedNode>;
+
+template <class T>
+using RbCompact = RbTree<T, std::less<T>, RbCompactNode>;
+
+template <class T>
+using Pairing = PairingHeap<T>;
+
+template <class T>
+using Binary = DaryHeap<T, std::less<T>, 2>;
+
+template <class T>
+using Quaternary = DaryHeap<T, std::less<T>, 4>;
+
+template <template <class> class Container>
+void run(char const *name) {
+    using T = Timer<Container>;
+    std::unique_ptr<T[]> timers(new T[kLive]);
+    Container<T> queue;
+    std::vector<std::size_t> armed; // 随机取消要能随机挑一个在队列里的定时器
+    std::vector<std::size_t> slotOf(kLive);
+    std::vector<std::size_t> freeList;
+    for (std::size_t i = kLive; i-- > 0;)
+        freeList.push_back(i);
+
+    auto disarm = [&](std::size_t index) {
+        timers[index].mArmed = false;
+        std::size_t slot = slotOf[index];
+        armed[slot] = armed.back();
+        slotOf[armed[slot]] = slot;
+        armed.pop_back();
+        freeList.push_back(index);
+    };
+
+    std::mt19937_64 rng(42);
+    std::uint64_t now = 0;
+    std::size_t inserts = 0, cancels = 0, expires = 0;
+
+    PerfCounter misses;
+    auto start = std::chrono::steady_clock::now();
+    misses.start();
+    for (std::size_t op = 0; op < kOps; ++op) {
+        now += rng() % 4;
+        while (!queue.empty() && queue.front().mExpireTime <= now) {
+            T &timer = queue.front();
+            queue.erase(timer);
+            disarm(std::size_t(&timer - timers.get()));
+            ++expires;
+        }
+        if (!armed.empty() && (freeList.empty() || rng() % 100 < kCancelPercent / 2)) {
+            std::size_t index = armed[rng() % armed.size()];
+            queue.erase(timers[index]);
+            disarm(index);
+            ++cancels;
+        } else {
+            std::size_t index = freeList.back();
+            freeList.pop_back();
+            timers[index].mExpireTime = now + 1000 + rng() % 100000;
+            timers[index].mArmed = true;
+            slotOf[index] = armed.size();
+            armed.push_back(index);
+            queue.insert(timers[index]);
+            ++inserts;
+        }
+    }
+    auto count = misses.stop();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::printf("%-12s %3zu bytes/node %8.1f ns/op", name, sizeof(typename Container<T>::Node),
+                elapsed.count() / double(kOps));
+    if (count)
+        std::printf(" %8.3f misses/op", double(*count) / double(kOps));
+    else
+        std::printf(" %8s misses/op", "n/a");
+    std::printf("  (%zu inserts, %zu cancels, %zu expires)\n", inserts, cancels, expires);
+
+    while (!queue.empty())
+        queue.erase(queue.front());
+}
+
+int main() {
+    run<RbPacked>("rbtree");
+    run<RbCompact>("rbtree-24b");
+    run<Pairing>("pairing");
+    run<Binary>("binary");
+    run<Quaternary>("4-ary");
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// 用 perf_event_open 统计一段代码的硬件事件（默认是缓存未命中）
+// 容器、虚拟机里经常没有权限或没有 PMU，这时 read() 返回 nullopt，基准照常跑
+struct PerfCounter {
+#if defined(__linux__)
+    explicit PerfCounter(std::uint64_t config = PERF_COUNT_HW_CACHE_MISSES) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        mFd = int(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    PerfCounter(PerfCounter &&) = delete;
+
+    ~PerfCounter() {
+        if (mFd != -1)
+            ::close(mFd);
+    }
+
+    void start() noexcept {
+        if (mFd == -1)
+            return;
+        ::ioctl(mFd, PERF_EVENT_IOC_RESET, 0);
+        ::ioctl(mFd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    std::optional<std::uint64_t> stop() noexcept {
+        if (mFd == -1)
+            return std::nullopt;
+        ::ioctl(mFd, PERF_EVENT_IOC_DISABLE, 0);
+        std::uint64_t value;
+        if (::read(mFd, &value, sizeof(value)) != sizeof(value))
+            return std::nullopt;
+        return value;
+    }
+
+private:
+    int mFd{-1};
+#else
+    PerfCounter() = default;
+
+    void start() noexcept {
+    }
+
+    std::optional<std::uint64_t> stop() noexcept {
+        return std::nullopt;
+    }
+#endif
+};
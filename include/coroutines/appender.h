@@ -0,0 +1,165 @@
+#pragma once
+
+#if !defined(__linux__)
+#error "appender.h requires POSIX file I/O (Linux)"
+#endif
+
+#include <cerrno>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include "coro.h"
+#include "thread_pool.h"
+
+// 追加写日志文件：co_await append(record) 在记录落盘（fdatasync 返回）之后才恢复
+// 同一时刻只有一次刷盘在线程池上进行，期间到达的记录拷进下一批的缓冲区，
+// 上一批完成后整批用一次 pwrite 写出、一次 fdatasync 提交（group commit）
+struct FileAppender {
+    FileAppender(char const *path, ThreadPool &pool = getThreadPool(), bool sync = true)
+        : mPool(pool), mLoop(getLoop()), mSync(sync) {
+        mFd = ::open(path, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        if (mFd == -1) [[unlikely]] {
+            throw std::system_error(errno, std::system_category(), "open");
+        }
+        auto end = ::lseek(mFd, 0, SEEK_END);
+        if (end == -1) [[unlikely]] {
+            int error = errno;
+            ::close(mFd);
+            throw std::system_error(error, std::system_category(), "lseek");
+        }
+        mOffset = std::uint64_t(end);
+    }
+
+    FileAppender(FileAppender &&) = delete;
+
+    // 必须等所有 append 完成之后再析构
+    ~FileAppender() {
+        ::close(mFd);
+    }
+
+    struct Waiter {
+        Waiter *mNext{};
+        std::coroutine_handle<> mCoroutine{};
+        std::exception_ptr mException{};
+    };
+
+    struct AppendAwaiter : Waiter {
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> coroutine) {
+            mCoroutine = coroutine;
+            mAppender.enqueue(this, mRecord);
+        }
+
+        void await_resume() const {
+            if (mException) [[unlikely]] {
+                std::rethrow_exception(mException);
+            }
+        }
+
+        FileAppender &mAppender;
+        std::string_view mRecord; // 只在 await_suspend 里读取，之后调用者可以释放
+    };
+
+    AppendAwaiter append(std::string_view record) noexcept {
+        return AppendAwaiter{{}, *this, record};
+    }
+
+    std::uint64_t bytesWritten() const noexcept {
+        return mBytesWritten;
+    }
+
+    std::size_t writeCount() const noexcept {
+        return mWriteCount;
+    }
+
+    std::size_t syncCount() const noexcept {
+        return mSyncCount;
+    }
+
+    FileAppender &operator=(FileAppender &&) = delete;
+
+private:
+    struct Batch {
+        std::string mBuffer;
+        Waiter *mHead{};
+        Waiter *mTail{};
+    };
+
+    void enqueue(Waiter *waiter, std::string_view record) {
+        mPending.mBuffer.append(record);
+        if (mPending.mTail)
+            mPending.mTail->mNext = waiter;
+        else
+            mPending.mHead = waiter;
+        mPending.mTail = waiter;
+        if (!mFlushing) {
+            mFlushing = true;
+            mFlusher.emplace(flush());
+            mLoop.addTask(mFlusher->mCoroutine);
+        }
+    }
+
+    // 在线程池上运行，同一时刻只有一个，所以 mOffset 不需要同步
+    void commit(std::string const &buffer) {
+        std::size_t done = 0;
+        while (done < buffer.size()) {
+            ssize_t n = ::pwrite(mFd, buffer.data() + done, buffer.size() - done,
+                                 off_t(mOffset + done));
+            if (n == -1) {
+                if (errno == EINTR)
+                    continue;
+                mOffset += done;
+                throw std::system_error(errno, std::system_category(), "pwrite");
+            }
+            done += std::size_t(n);
+        }
+        mOffset += done;
+        if (mSync && ::fdatasync(mFd) == -1) [[unlikely]] {
+            throw std::system_error(errno, std::system_category(), "fdatasync");
+        }
+    }
+
+    Task<void> flush() {
+        while (mPending.mHead) {
+            Batch batch = std::exchange(mPending, {});
+            std::exception_ptr exception;
+            try {
+                co_await offload(mPool, [this, &batch] { commit(batch.mBuffer); });
+                mBytesWritten += batch.mBuffer.size();
+                ++mWriteCount;
+                mSyncCount += mSync;
+            } catch (...) {
+                exception = std::current_exception();
+            }
+            for (Waiter *waiter = batch.mHead; waiter;) {
+                Waiter *next = waiter->mNext;
+                waiter->mException = exception;
+                mLoop.addTask(waiter->mCoroutine);
+                waiter = next;
+            }
+        }
+        mFlushing = false;
+    }
+
+    ThreadPool &mPool;
+    Loop &mLoop;
+    bool mSync;
+    int mFd{-1};
+    std::uint64_t mOffset{0};
+    Batch mPending{};
+    bool mFlushing{false};
+    std::optional<Task<void> > mFlusher{};
+    std::uint64_t mBytesWritten{0};
+    std::size_t mWriteCount{0};
+    std::size_t mSyncCount{0};
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include "coro.h"
+#include "shared_task.h"
+
+// 异步缓存：同一个 key 的并发未命中只会启动一次 loader，其余请求等待同一个 SharedTask
+// 条目在加载完成 mTtl 之后过期，由一个睡在 Loop 定时器上的清扫协程回收
+// 条目数超过 mCapacity 时按 LRU 淘汰；缓存必须比它发起的加载活得更久
+template<class Key, class Value, class Hash = std::hash<Key>, class Equal = std::equal_to<Key> >
+struct AsyncCache {
+    using Clock = std::chrono::system_clock;
+
+    AsyncCache(std::size_t capacity, Clock::duration ttl)
+        : mCapacity(capacity == 0 ? 1 : capacity), mTtl(ttl) {
+    }
+
+    AsyncCache(AsyncCache &&) = delete;
+
+    // loader(key) 返回一个结果为 Value 的 Awaitable，例如 Task<Value>
+    template<class F>
+    Task<Value> get(Key key, F loader) {
+        auto it = mIndex.find(key);
+        if (it != mIndex.end()) {
+            auto entry = it->second;
+            if (entry->mExpireTime > getLoop().now()) {
+                ++mHits;
+                mLru.splice(mLru.begin(), mLru, entry);
+                SharedTask<Value> shared = entry->mTask;
+                co_return co_await shared;
+            }
+            eraseEntry(entry);
+        }
+        ++mMisses;
+        std::uint64_t generation = ++mGeneration;
+        SharedTask<Value> shared = load(key, std::move(loader), generation);
+        mLru.push_front(Entry{key, shared, Clock::time_point::max(), generation});
+        mIndex.emplace(std::move(key), mLru.begin());
+        if (mLru.size() > mCapacity)
+            eraseEntry(std::prev(mLru.end()));
+        co_return co_await shared;
+    }
+
+    bool erase(Key const &key) {
+        auto it = mIndex.find(key);
+        if (it == mIndex.end())
+            return false;
+        eraseEntry(it->second);
+        return true;
+    }
+
+    std::size_t size() const noexcept {
+        return mLru.size();
+    }
+
+    std::size_t hits() const noexcept {
+        return mHits;
+    }
+
+    std::size_t misses() const noexcept {
+        return mMisses;
+    }
+
+    AsyncCache &operator=(AsyncCache &&) = delete;
+
+private:
+    struct Entry {
+        Key mKey;
+        SharedTask<Value> mTask;
+        Clock::time_point mExpireTime;
+        std::uint64_t mGeneration;
+    };
+
+    struct Expiry {
+        Clock::time_point mExpireTime;
+        Key mKey;
+        std::uint64_t mGeneration;
+    };
+
+    using EntryIter = std::list<Entry>::iterator;
+
+    std::optional<EntryIter> findEntry(Key const &key, std::uint64_t generation) {
+        auto it = mIndex.find(key);
+        if (it == mIndex.end() || it->second->mGeneration != generation)
+            return std::nullopt;
+        return it->second;
+    }
+
+    void eraseEntry(EntryIter entry) {
+        mIndex.erase(entry->mKey);
+        mLru.erase(entry);
+    }
+
+    template<class F>
+    SharedTask<Value> load(Key key, F loader, std::uint64_t generation) {
+        std::optional<Value> value;
+        try {
+            value.emplace(co_await loader(key));
+        } catch (...) {
+            // 失败的结果不缓存，下一次 get 会重新加载
+            if (auto entry = findEntry(key, generation))
+                eraseEntry(*entry);
+            throw;
+        }
+        if (auto entry = findEntry(key, generation)) {
+            auto expireTime = getLoop().now() + mTtl;
+            (*entry)->mExpireTime = expireTime;
+            mExpiry.push_back(Expiry{expireTime, std::move(key), generation});
+            startSweeper();
+        }
+        co_return std::move(*value);
+    }
+
+    void startSweeper() {
+        if (mSweeping)
+            return;
+        mSweeping = true;
+        mSweeper.emplace(sweep());
+        getLoop().addTask(mSweeper->mCoroutine);
+    }
+
+    // TTL 固定，所以 mExpiry 天然按过期时间排序，只需要看队首
+    Task<void> sweep() {
+        while (!mExpiry.empty()) {
+            auto &front = mExpiry.front();
+            if (front.mExpireTime > getLoop().now()) {
+                co_await sleep_until(front.mExpireTime);
+                continue;
+            }
+            if (auto entry = findEntry(front.mKey, front.mGeneration))
+                eraseEntry(*entry);
+            mExpiry.pop_front();
+        }
+        mSweeping = false;
+    }
+
+    std::size_t mCapacity;
+    Clock::duration mTtl;
+    std::list<Entry> mLru{};
+    std::unordered_map<Key, EntryIter, Hash, Equal> mIndex{};
+    std::deque<Expiry> mExpiry{};
+    std::uint64_t mGeneration{0};
+    std::size_t mHits{0};
+    std::size_t mMisses{0};
+    bool mSweeping{false};
+    std::optional<Task<void> > mSweeper{};
+};
@@ -0,0 +1,863 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <thread>
+#include <tuple>
+#include <variant>
+#include <vector>
+#if defined(__linux__)
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+#include "dary_heap.h"
+#include "frame_profiler.h"
+#include "pairing_heap.h"
+#include "rbtree.h"
+#include "timer_store.h"
+
+using namespace std::chrono_literals;
+
+template<class T = void>
+struct NonVoidHelper {
+    using Type = T;
+};
+
+template<>
+struct NonVoidHelper<void> {
+    using Type = NonVoidHelper;
+
+    explicit NonVoidHelper() = default;
+};
+
+template<class T>
+struct Uninitialized {
+    union {
+        T mValue;
+    };
+
+    Uninitialized() noexcept {
+    }
+
+    Uninitialized(Uninitialized &&) = delete;
+
+    ~Uninitialized() noexcept {
+    }
+
+    T moveValue() {
+        T ret(std::move(mValue));
+        mValue.~T();
+        return ret;
+    }
+
+    template<class... Ts>
+    void putValue(Ts &&... args) {
+        new(std::addressof(mValue)) T(std::forward<Ts>(args)...);
+    }
+};
+
+template<>
+struct Uninitialized<void> {
+    auto moveValue() {
+        return NonVoidHelper<>{};
+    }
+
+    void putValue(NonVoidHelper<>) {
+    }
+};
+
+template<class T>
+struct Uninitialized<T const> : Uninitialized<T> {
+};
+
+template<class T>
+struct Uninitialized<T &> : Uninitialized<std::reference_wrapper<T> > {
+};
+
+template<class T>
+struct Uninitialized<T &&> : Uninitialized<T> {
+};
+
+template<class A>
+concept Awaiter = requires(A a, std::coroutine_handle<> h)
+{
+    { a.await_ready() };
+    { a.await_suspend(h) };
+    { a.await_resume() };
+};
+
+template<class A>
+concept Awaitable = Awaiter<A> || requires(A a)
+{
+    { a.operator co_await() } -> Awaiter;
+};
+
+template<class A>
+struct AwaitableTraits;
+
+template<Awaiter A>
+struct AwaitableTraits<A> {
+    using RetType = decltype(std::declval<A>().await_resume());
+    using NonVoidRetType = NonVoidHelper<RetType>::Type;
+};
+
+template<class A>
+    requires(!Awaiter<A> && Awaitable<A>)
+struct AwaitableTraits<A>
+        : AwaitableTraits<decltype(std::declval<A>().operator co_await())> {
+};
+
+template<class To, std::derived_from<To> P>
+constexpr std::coroutine_handle<To> staticHandleCast(std::coroutine_handle<P> coroutine) {
+    return std::coroutine_handle<To>::from_address(coroutine.address());
+}
+
+struct RepeatAwaiter {
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<> coroutine) const noexcept {
+        if (coroutine.done())
+            return std::noop_coroutine();
+        else
+            return coroutine;
+    }
+
+    void await_resume() const noexcept {
+    }
+};
+
+struct PreviousAwaiter {
+    std::coroutine_handle<> mPrevious;
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<> coroutine) const noexcept {
+        if (mPrevious)
+            return mPrevious;
+        else
+            return std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {
+    }
+};
+
+template<class T>
+struct Promise : FrameProfileHook {
+    Promise(std::source_location loc = std::source_location::current()) noexcept
+        : FrameProfileHook(loc) {
+    }
+
+    auto initial_suspend() noexcept {
+        return std::suspend_always();
+    }
+
+    auto final_suspend() noexcept {
+        return PreviousAwaiter(mPrevious);
+    }
+
+    void unhandled_exception() noexcept {
+        mException = std::current_exception();
+    }
+
+    void return_value(T &&ret) {
+        mResult.putValue(std::move(ret));
+    }
+
+    void return_value(T const &ret) {
+        mResult.putValue(ret);
+    }
+
+    T result() {
+        if (mException) [[unlikely]] {
+            std::rethrow_exception(mException);
+        }
+        return mResult.moveValue();
+    }
+
+    auto get_return_object() {
+        return std::coroutine_handle<Promise>::from_promise(*this);
+    }
+
+    std::coroutine_handle<> mPrevious{};
+    std::exception_ptr mException{};
+    Uninitialized<T> mResult;
+
+    Promise &operator=(Promise &&) = delete;
+};
+
+template<>
+struct Promise<void> : FrameProfileHook {
+    Promise(std::source_location loc = std::source_location::current()) noexcept
+        : FrameProfileHook(loc) {
+    }
+
+    auto initial_suspend() noexcept {
+        return std::suspend_always();
+    }
+
+    auto final_suspend() noexcept {
+        return PreviousAwaiter(mPrevious);
+    }
+
+    void unhandled_exception() noexcept {
+        mException = std::current_exception();
+    }
+
+    void return_void() noexcept {
+    }
+
+    void result() {
+        if (mException) [[unlikely]] {
+            std::rethrow_exception(mException);
+        }
+    }
+
+    auto get_return_object() {
+        return std::coroutine_handle<Promise>::from_promise(*this);
+    }
+
+    std::coroutine_handle<> mPrevious{};
+    std::exception_ptr mException{};
+
+    Promise &operator=(Promise &&) = delete;
+};
+
+template<class T = void, class P = Promise<T> >
+struct Task {
+    using promise_type = P;
+
+    Task(std::coroutine_handle<promise_type> coroutine) noexcept
+        : mCoroutine(coroutine) {
+    }
+
+    Task(Task &&that) noexcept
+        : mCoroutine(std::exchange(that.mCoroutine, nullptr)) {
+    }
+
+    Task &operator=(Task &&) = delete;
+
+    ~Task() {
+        if (mCoroutine)
+            mCoroutine.destroy();
+    }
+
+    struct Awaiter {
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        std::coroutine_handle<promise_type>
+        await_suspend(std::coroutine_handle<> coroutine) const noexcept {
+            mCoroutine.promise().mPrevious = coroutine;
+            return mCoroutine;
+        }
+
+        T await_resume() const {
+            return mCoroutine.promise().result();
+        }
+
+        std::coroutine_handle<promise_type> mCoroutine;
+    };
+
+    auto operator co_await() const noexcept {
+        return Awaiter(mCoroutine);
+    }
+
+    operator std::coroutine_handle<>() const noexcept {
+        return mCoroutine;
+    }
+
+    std::coroutine_handle<promise_type> mCoroutine;
+};
+
+// Loop 的定时器容器：只需要 insert/erase/front/empty，sleep 协程的 promise 继承容器的 Node
+// 用 CORO_TIMER_QUEUE 选择，整个程序必须一致
+struct RbTimerQueue {
+    // 颜色压进 parent 指针，每个 sleep 帧省 8 字节；协程帧可能在等待中被销毁，所以保留自动摘除
+    template<class T>
+    using Container = RbTree<T, std::less<T>, RbPackedNode>;
+};
+
+struct PairingTimerQueue {
+    template<class T>
+    using Container = PairingHeap<T>;
+};
+
+struct QuaternaryTimerQueue {
+    template<class T>
+    using Container = DaryHeap<T, std::less<T>, 4>;
+};
+
+#ifndef CORO_TIMER_QUEUE
+#define CORO_TIMER_QUEUE RbTimerQueue
+#endif
+
+template<class Queue>
+struct BasicSleepUntilPromise
+    : Queue::template Container<BasicSleepUntilPromise<Queue> >::Node, Promise<void> {
+    BasicSleepUntilPromise(std::source_location loc = std::source_location::current()) noexcept
+        : Promise<void>(loc) {
+    }
+
+    std::chrono::system_clock::time_point mExpireTime;
+
+    auto get_return_object() {
+        return std::coroutine_handle<BasicSleepUntilPromise>::from_promise(*this);
+    }
+
+    BasicSleepUntilPromise &operator=(BasicSleepUntilPromise &&) = delete;
+
+    friend bool operator<(BasicSleepUntilPromise const &lhs, BasicSleepUntilPromise const &rhs) noexcept {
+        return lhs.mExpireTime < rhs.mExpireTime;
+    }
+};
+
+template<class Queue>
+struct BasicLoop {
+    using SleepUntilPromise = BasicSleepUntilPromise<Queue>;
+
+    typename Queue::template Container<SleepUntilPromise> mTimers{};
+    std::deque<std::coroutine_handle<> > mReadyQueue{};
+
+    // 其他线程设置的定时器，按线程分片加锁，到期后由 run 所在线程执行回调
+    ConcurrentTimerStore mTimerStore;
+
+    // run 将要睡到的时间点（没有定时器时是 kNever），醒着时是 kAwake；armTimer 插入之后和它比较，决定要不要叫醒 Loop
+    static constexpr std::int64_t kAwake = std::numeric_limits<std::int64_t>::min();
+    std::atomic<std::int64_t> mWaitDeadline{kAwake};
+
+    // 其他线程只能通过 postTask 把协程交还给 Loop，由 run 所在线程恢复
+    std::mutex mRemoteMutex;
+    std::condition_variable mRemoteCondition;
+    std::deque<std::coroutine_handle<> > mRemoteQueue{};
+    std::atomic<std::size_t> mRemotePending{0};
+
+    // 虚拟时间模式下没有就绪任务时直接把时钟拨到最早的定时器，而不是真的睡过去
+    bool mVirtualTime{false};
+    std::chrono::system_clock::time_point mVirtualNow{};
+
+    std::chrono::system_clock::time_point now() const {
+        if (mVirtualTime)
+            return mVirtualNow;
+        return std::chrono::system_clock::now();
+    }
+
+    void setVirtualTime(std::chrono::system_clock::time_point start = std::chrono::system_clock::now()) {
+        mVirtualTime = true;
+        mVirtualNow = start;
+    }
+
+    void setRealTime() {
+        mVirtualTime = false;
+    }
+
+    void addTimer(SleepUntilPromise &promise) {
+        mTimers.insert(promise);
+    }
+
+    void addTask(std::coroutine_handle<> coroutine) {
+        mReadyQueue.push_back(coroutine);
+    }
+
+    // 在把协程交给其他线程之前调用，保证 run 会等它回来而不是提前退出
+    void expectRemote() noexcept {
+        mRemotePending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void postTask(std::coroutine_handle<> coroutine) {
+        {
+            std::lock_guard lock(mRemoteMutex);
+            mRemoteQueue.push_back(coroutine);
+        }
+        mRemoteCondition.notify_one();
+#if defined(__linux__)
+        if (int wakeFd = mWakeFd.load(std::memory_order_acquire); wakeFd != -1) {
+            std::uint64_t one = 1;
+            (void) ::write(wakeFd, &one, sizeof(one));
+        }
+#endif
+    }
+
+    // 任意线程都可以调用，callback 在 run 所在线程上执行；timer 要活到回调执行完或被取消
+    // 和 postTask 一样，调用者要自己保证 run 在定时器到期前不会因为无事可做而退出
+    void armTimer(ConcurrentTimer &timer, std::chrono::system_clock::time_point expireTime,
+                  std::function<void()> callback) {
+        mTimerStore.arm(timer, expireTime, std::move(callback));
+        // 先插入再读 run 公布的截止时间，和 prepareWait 的顺序相反：run 要么在睡前看到这个定时器，
+        // 要么在这里被看到正要睡到更晚的时间，这时投递一个空任务让它重新计算等待时间
+        if (expireTime.time_since_epoch().count() < mWaitDeadline.load()) {
+            expectRemote();
+            postTask(std::noop_coroutine());
+        }
+    }
+
+    // 正在等待文件描述符就绪的协程个数，只要不为零 run 就会阻塞在 epoll 上
+    std::size_t mIoPending{0};
+
+#if defined(__linux__)
+    // 挂在 epoll 上的等待者，通常就是 co_await 表达式里的 Awaiter 本身
+    struct IoWaiter {
+        int mFd;
+        std::coroutine_handle<> mCoroutine{};
+        bool mRegistered{false};
+    };
+
+    void addIoWaiter(IoWaiter &waiter, std::uint32_t events) {
+        if (mEpoll == -1)
+            openEpoll();
+        epoll_event event{};
+        event.events = events;
+        event.data.ptr = &waiter;
+        if (epoll_ctl(mEpoll, EPOLL_CTL_ADD, waiter.mFd, &event) == -1) [[unlikely]] {
+            throw std::system_error(errno, std::system_category(), "epoll_ctl");
+        }
+        waiter.mRegistered = true;
+        ++mIoPending;
+    }
+
+    // 就绪后或等待者被销毁时调用，保证 epoll 里不会留下悬空的指针
+    void removeIoWaiter(IoWaiter &waiter) noexcept {
+        if (!waiter.mRegistered)
+            return;
+        epoll_ctl(mEpoll, EPOLL_CTL_DEL, waiter.mFd, nullptr);
+        waiter.mRegistered = false;
+        --mIoPending;
+    }
+
+    BasicLoop() = default;
+
+    ~BasicLoop() {
+        if (mEpoll != -1)
+            ::close(mEpoll);
+        if (int wakeFd = mWakeFd.load(std::memory_order_relaxed); wakeFd != -1)
+            ::close(wakeFd);
+    }
+#endif
+
+    void run(std::coroutine_handle<> coroutine) {
+        addTask(coroutine);
+        while (!coroutine.done()) {
+            takeRemoteTasks();
+            while (!mReadyQueue.empty()) {
+                auto ready = mReadyQueue.front();
+                mReadyQueue.pop_front();
+                ready.resume();
+            }
+            if (coroutine.done())
+                break;
+            if (mTimerStore.fireExpired(now()) != 0)
+                continue;
+            auto expireTime = nextExpireTime();
+            bool hasTimer = expireTime.has_value();
+            if (!mTimers.empty()) {
+                auto &promise = mTimers.front();
+                if (promise.mExpireTime <= now()) {
+                    mTimers.erase(promise);
+                    std::coroutine_handle<SleepUntilPromise>::from_promise(promise).resume();
+                    continue;
+                }
+            }
+            if (mIoPending != 0) {
+                if (!prepareWait(expireTime))
+                    continue;
+                waitIo(expireTime);
+                mWaitDeadline.store(kAwake, std::memory_order_relaxed);
+            } else if (mRemotePending.load(std::memory_order_acquire) != 0 || (hasTimer && !mVirtualTime)) {
+                if (!prepareWait(expireTime))
+                    continue;
+                // 用条件变量而不是 sleep_until 等定时器，其他线程设置了更早的定时器时能被叫醒
+                std::unique_lock lock(mRemoteMutex);
+                if (hasTimer && !mVirtualTime) {
+                    mRemoteCondition.wait_until(lock, *expireTime, [this] { return !mRemoteQueue.empty(); });
+                } else {
+                    mRemoteCondition.wait(lock, [this] { return !mRemoteQueue.empty(); });
+                }
+                mWaitDeadline.store(kAwake, std::memory_order_relaxed);
+            } else if (hasTimer) {
+                mVirtualNow = std::max(mVirtualNow, *expireTime);
+            } else {
+                break; // 没有任何可以唤醒协程的事件，继续等待只会死锁
+            }
+        }
+    }
+
+    BasicLoop &operator=(BasicLoop &&) = delete;
+
+private:
+    std::optional<std::chrono::system_clock::time_point> nextExpireTime() const noexcept {
+        auto expireTime = mTimerStore.earliest();
+        if (!mTimers.empty() && (!expireTime || mTimers.front().mExpireTime < *expireTime))
+            expireTime = mTimers.front().mExpireTime;
+        return expireTime;
+    }
+
+    // 睡前公布要睡到什么时候，然后再看一眼 mTimerStore；期间有其他线程设置了更早的定时器就不睡，返回 false
+    bool prepareWait(std::optional<std::chrono::system_clock::time_point> expireTime) noexcept {
+        std::int64_t deadline = expireTime ? expireTime->time_since_epoch().count() : TimerShard::kNever;
+        mWaitDeadline.store(deadline);
+        if (auto earliest = mTimerStore.earliest(); earliest && earliest->time_since_epoch().count() < deadline) {
+            mWaitDeadline.store(kAwake, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    void takeRemoteTasks() {
+        if (mRemotePending.load(std::memory_order_acquire) == 0)
+            return;
+        std::lock_guard lock(mRemoteMutex);
+        mRemotePending.fetch_sub(mRemoteQueue.size(), std::memory_order_relaxed);
+        for (auto remote: mRemoteQueue)
+            mReadyQueue.push_back(remote);
+        mRemoteQueue.clear();
+    }
+
+    void waitIo(std::optional<std::chrono::system_clock::time_point> expireTime) {
+#if defined(__linux__)
+        bool hasTimer = expireTime.has_value();
+        int timeout = -1;
+        bool remotePending = mRemotePending.load(std::memory_order_acquire) != 0;
+        if (hasTimer && mVirtualTime) {
+            timeout = remotePending ? -1 : 0;
+        } else if (hasTimer) {
+            auto wait = *expireTime - now();
+            timeout = int(std::max<std::chrono::milliseconds::rep>(
+                0, std::chrono::ceil<std::chrono::milliseconds>(wait).count()));
+        }
+        if (remotePending) {
+            // 唤醒用的 eventfd 可能是在对方投递之后才创建的，先看一眼队列
+            std::lock_guard lock(mRemoteMutex);
+            if (!mRemoteQueue.empty())
+                timeout = 0;
+        }
+        epoll_event events[64];
+        int n = epoll_wait(mEpoll, events, 64, timeout);
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.ptr == nullptr) {
+                std::uint64_t count;
+                (void) ::read(mWakeFd.load(std::memory_order_relaxed), &count, sizeof(count));
+                continue;
+            }
+            auto &waiter = *static_cast<IoWaiter *>(events[i].data.ptr);
+            removeIoWaiter(waiter);
+            addTask(waiter.mCoroutine);
+        }
+        if (n <= 0 && hasTimer && mVirtualTime && !remotePending)
+            mVirtualNow = std::max(mVirtualNow, *expireTime);
+#endif
+    }
+
+#if defined(__linux__)
+    void openEpoll() {
+        mEpoll = epoll_create1(EPOLL_CLOEXEC);
+        if (mEpoll == -1) [[unlikely]] {
+            throw std::system_error(errno, std::system_category(), "epoll_create1");
+        }
+        int wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (wakeFd == -1) [[unlikely]] {
+            throw std::system_error(errno, std::system_category(), "eventfd");
+        }
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr;
+        epoll_ctl(mEpoll, EPOLL_CTL_ADD, wakeFd, &event);
+        mWakeFd.store(wakeFd, std::memory_order_release);
+    }
+
+    int mEpoll{-1};
+    std::atomic<int> mWakeFd{-1};
+#endif
+};
+
+using SleepUntilPromise = BasicSleepUntilPromise<CORO_TIMER_QUEUE>;
+using Loop = BasicLoop<CORO_TIMER_QUEUE>;
+
+inline Loop &getLoop() {
+    static Loop loop;
+    return loop;
+}
+
+struct SleepAwaiter {
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<SleepUntilPromise> coroutine) const {
+        auto &promise = coroutine.promise();
+        promise.mExpireTime = mExpireTime;
+        loop.addTimer(promise);
+    }
+
+    void await_resume() const noexcept {
+    }
+
+    Loop &loop;
+    std::chrono::system_clock::time_point mExpireTime;
+};
+
+inline Task<void, SleepUntilPromise> sleep_until(std::chrono::system_clock::time_point expireTime) {
+    auto &loop = getLoop();
+    co_await SleepAwaiter(loop, expireTime);
+}
+
+inline Task<void, SleepUntilPromise> sleep_for(std::chrono::system_clock::duration duration) {
+    auto &loop = getLoop();
+    co_await SleepAwaiter(loop, loop.now() + duration);
+}
+
+struct CurrentCoroutineAwaiter {
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<> coroutine) noexcept {
+        mCurrent = coroutine;
+        return coroutine;
+    }
+
+    auto await_resume() const noexcept {
+        return mCurrent;
+    }
+
+    std::coroutine_handle<> mCurrent;
+};
+
+struct ReturnPreviousPromise : FrameProfileHook {
+    ReturnPreviousPromise(std::source_location loc = std::source_location::current()) noexcept
+        : FrameProfileHook(loc) {
+    }
+
+    auto initial_suspend() noexcept {
+        return std::suspend_always();
+    }
+
+    auto final_suspend() noexcept {
+        return PreviousAwaiter(mPrevious);
+    }
+
+    void unhandled_exception() {
+        throw;
+    }
+
+    void return_value(std::coroutine_handle<> previous) noexcept {
+        mPrevious = previous;
+    }
+
+    auto get_return_object() {
+        return std::coroutine_handle<ReturnPreviousPromise>::from_promise(
+            *this);
+    }
+
+    std::coroutine_handle<> mPrevious{};
+
+    ReturnPreviousPromise &operator=(ReturnPreviousPromise &&) = delete;
+};
+
+struct ReturnPreviousTask {
+    using promise_type = ReturnPreviousPromise;
+
+    ReturnPreviousTask(std::coroutine_handle<promise_type> coroutine) noexcept
+        : mCoroutine(coroutine) {
+    }
+
+    ReturnPreviousTask(ReturnPreviousTask &&that) noexcept
+        : mCoroutine(std::exchange(that.mCoroutine, nullptr)) {
+    }
+
+    ReturnPreviousTask &operator=(ReturnPreviousTask &&) = delete;
+
+    ~ReturnPreviousTask() {
+        if (mCoroutine)
+            mCoroutine.destroy();
+    }
+
+    std::coroutine_handle<promise_type> mCoroutine;
+};
+
+struct WhenAllCtlBlock {
+    std::size_t mCount;
+    std::coroutine_handle<> mPrevious{};
+    std::exception_ptr mException{};
+};
+
+struct WhenAllAwaiter {
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<> coroutine) const {
+        if (mTasks.empty()) return coroutine;
+        mControl.mPrevious = coroutine;
+        for (auto const &t: mTasks.subspan(0, mTasks.size() - 1))
+            t.mCoroutine.resume();
+        return mTasks.back().mCoroutine;
+    }
+
+    void await_resume() const {
+        if (mControl.mException) [[unlikely]] {
+            std::rethrow_exception(mControl.mException);
+        }
+    }
+
+    WhenAllCtlBlock &mControl;
+    std::span<ReturnPreviousTask const> mTasks;
+};
+
+template<class T>
+ReturnPreviousTask whenAllHelper(auto const &t, WhenAllCtlBlock &control,
+                                 Uninitialized<T> &result) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await t;
+            result.putValue(NonVoidHelper<>{});
+        } else {
+            result.putValue(co_await t);
+        }
+    } catch (...) {
+        control.mException = std::current_exception();
+        co_return control.mPrevious;
+    }
+    --control.mCount;
+    if (control.mCount == 0) {
+        co_return control.mPrevious;
+    }
+    co_return nullptr;
+}
+
+template<std::size_t... Is, class... Ts>
+Task<std::tuple<typename AwaitableTraits<Ts>::NonVoidRetType...> >
+whenAllImpl(std::index_sequence<Is...>, Ts &&... ts) {
+    WhenAllCtlBlock control{sizeof...(Ts)};
+    std::tuple<Uninitialized<typename AwaitableTraits<Ts>::RetType>...> result;
+    ReturnPreviousTask taskArray[]{whenAllHelper(ts, control, std::get<Is>(result))...};
+    co_await WhenAllAwaiter(control, taskArray);
+    co_return std::tuple<typename AwaitableTraits<Ts>::NonVoidRetType...>(
+        std::get<Is>(result).moveValue()...);
+}
+
+template<Awaitable... Ts>
+    requires(sizeof...(Ts) != 0)
+auto when_all(Ts &&... ts) {
+    return whenAllImpl(std::make_index_sequence<sizeof...(Ts)>{},
+                       std::forward<Ts>(ts)...);
+}
+
+template<class R>
+Task<std::vector<typename AwaitableTraits<std::ranges::range_reference_t<R> >::NonVoidRetType> >
+whenAllRangeImpl(R &tasks) {
+    using RetType = AwaitableTraits<std::ranges::range_reference_t<R> >::RetType;
+    WhenAllCtlBlock control{std::ranges::size(tasks)};
+    std::vector<Uninitialized<RetType> > result(control.mCount);
+    std::vector<ReturnPreviousTask> taskArray;
+    taskArray.reserve(control.mCount);
+    std::size_t i = 0;
+    for (auto &&t: tasks)
+        taskArray.push_back(whenAllHelper(t, control, result[i++]));
+    co_await WhenAllAwaiter(control, taskArray);
+    std::vector<typename AwaitableTraits<std::ranges::range_reference_t<R> >::NonVoidRetType> ret;
+    ret.reserve(result.size());
+    for (auto &r: result)
+        ret.push_back(r.moveValue());
+    co_return ret;
+}
+
+// 等待数量在运行时才确定的一组任务，例如 std::vector<Task<T>>
+template<std::ranges::sized_range R>
+    requires Awaitable<std::ranges::range_reference_t<R> >
+auto when_all(R &tasks) {
+    return whenAllRangeImpl(tasks);
+}
+
+struct WhenAnyCtlBlock {
+    static constexpr std::size_t kNullIndex = std::size_t(-1);
+
+    std::size_t mIndex{kNullIndex};
+    std::coroutine_handle<> mPrevious{};
+    std::exception_ptr mException{};
+};
+
+struct WhenAnyAwaiter {
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<> coroutine) const {
+        if (mTasks.empty()) return coroutine;
+        mControl.mPrevious = coroutine;
+        for (auto const &t: mTasks.subspan(0, mTasks.size() - 1))
+            t.mCoroutine.resume();
+        return mTasks.back().mCoroutine;
+    }
+
+    void await_resume() const {
+        if (mControl.mException) [[unlikely]] {
+            std::rethrow_exception(mControl.mException);
+        }
+    }
+
+    WhenAnyCtlBlock &mControl;
+    std::span<ReturnPreviousTask const> mTasks;
+};
+
+template<class T>
+ReturnPreviousTask whenAnyHelper(auto const &t, WhenAnyCtlBlock &control,
+                                 Uninitialized<T> &result, std::size_t index) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await t;
+            result.putValue(NonVoidHelper<>{});
+        } else {
+            result.putValue(co_await t);
+        }
+    } catch (...) {
+        control.mException = std::current_exception();
+        co_return control.mPrevious;
+    }
+    --control.mIndex = index;
+    co_return control.mPrevious;
+}
+
+template<std::size_t... Is, class... Ts>
+Task<std::variant<typename AwaitableTraits<Ts>::NonVoidRetType...> >
+whenAnyImpl(std::index_sequence<Is...>, Ts &&... ts) {
+    WhenAnyCtlBlock control{};
+    std::tuple<Uninitialized<typename AwaitableTraits<Ts>::RetType>...> result;
+    ReturnPreviousTask taskArray[]{whenAnyHelper(ts, control, std::get<Is>(result), Is)...};
+    co_await WhenAnyAwaiter(control, taskArray);
+    Uninitialized<std::variant<typename AwaitableTraits<Ts>::NonVoidRetType...> > varResult;
+    ((control.mIndex == Is && (varResult.putValue(
+                                   std::in_place_index<Is>, std::get<Is>(result).moveValue()), 0)), ...);
+    co_return varResult.moveValue();
+}
+
+template<Awaitable... Ts>
+    requires(sizeof...(Ts) != 0)
+auto when_any(Ts &&... ts) {
+    return whenAnyImpl(std::make_index_sequence<sizeof...(Ts)>{},
+                       std::forward<Ts>(ts)...);
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// 侵入式 d 叉堆：Value 继承 DaryHeap::Node，接口与 RbTree 相同（insert/erase/front/empty）
+// 节点记住自己在数组里的下标，所以可以 O(log n) 删除任意节点；
+// 指针数组连续存放，D = 4 时一次下沉比较的四个孩子通常落在同一条缓存行里
+// insert 可能因为数组扩容抛 std::bad_alloc；相等的元素之间不保证先进先出
+template <class Value, class Compare = std::less<Value>, std::size_t D = 4>
+struct DaryHeap {
+    static_assert(D >= 2);
+
+    struct Node {
+        Node() noexcept = default;
+
+        Node(Node &&) = delete;
+
+        ~Node() noexcept {
+            if (heap) {
+                heap->doErase(this);
+            }
+        }
+
+        friend struct DaryHeap;
+
+    private:
+        std::size_t index{0};
+        DaryHeap *heap{nullptr};
+    };
+
+private:
+    std::vector<Node *> nodes;
+    Compare comp;
+
+    bool compare(Node *left, Node *right) const noexcept {
+        return comp(static_cast<Value &>(*left), static_cast<Value &>(*right));
+    }
+
+    void place(Node *node, std::size_t index) noexcept {
+        nodes[index] = node;
+        node->index = index;
+    }
+
+    // 空穴法：沿途只移动父节点，最后把 node 放进空出来的位置
+    void siftUp(Node *node, std::size_t index) noexcept {
+        while (index > 0) {
+            std::size_t parent = (index - 1) / D;
+            if (!compare(node, nodes[parent])) {
+                break;
+            }
+            place(nodes[parent], index);
+            index = parent;
+        }
+        place(node, index);
+    }
+
+    void siftDown(Node *node, std::size_t index) noexcept {
+        std::size_t size = nodes.size();
+        while (true) {
+            std::size_t first = index * D + 1;
+            if (first >= size) {
+                break;
+            }
+            std::size_t last = first + D < size ? first + D : size;
+            std::size_t best = first;
+            for (std::size_t child = first + 1; child < last; ++child) {
+                if (compare(nodes[child], nodes[best])) {
+                    best = child;
+                }
+            }
+            if (!compare(nodes[best], node)) {
+                break;
+            }
+            place(nodes[best], index);
+            index = best;
+        }
+        place(node, index);
+    }
+
+    void doInsert(Node *node) {
+        nodes.push_back(node);
+        node->heap = this;
+        siftUp(node, nodes.size() - 1);
+    }
+
+    void doErase(Node *node) noexcept {
+        node->heap = nullptr;
+        std::size_t index = node->index;
+        Node *last = nodes.back();
+        nodes.pop_back();
+        if (last == node) {
+            return;
+        }
+        // 用最后一个节点填上空位，它可能需要上浮也可能需要下沉
+        if (index > 0 && compare(last, nodes[(index - 1) / D])) {
+            siftUp(last, index);
+        } else {
+            siftDown(last, index);
+        }
+    }
+
+public:
+    DaryHeap() = default;
+
+    explicit DaryHeap(Compare comp) noexcept(noexcept(Compare(comp)))
+        : comp(comp) {}
+
+    DaryHeap(DaryHeap &&) = delete;
+
+    ~DaryHeap() noexcept {}
+
+    void insert(Value &value) {
+        doInsert(&static_cast<Node &>(value));
+    }
+
+    void erase(Value &value) noexcept {
+        doErase(&static_cast<Node &>(value));
+    }
+
+    bool empty() const noexcept {
+        return nodes.empty();
+    }
+
+    std::size_t size() const noexcept {
+        return nodes.size();
+    }
+
+    Value &front() const noexcept {
+        return static_cast<Value &>(*nodes.front());
+    }
+
+    // 预留数组容量，之后 insert 在容量以内不会分配内存
+    void reserve(std::size_t capacity) {
+        nodes.reserve(capacity);
+    }
+};
@@ -0,0 +1,279 @@
+#pragma once
+
+#include <version>
+
+#if !defined(__cpp_lib_expected) || __cpp_lib_expected < 202202L
+#error "expected_task.h requires std::expected (C++23)"
+#endif
+
+#include <concepts>
+#include <expected>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <variant>
+#include "coro.h"
+
+// Task<std::expected<T, E>> 的错误走返回值而不是异常：
+// co_await try_await(task) 在 task 失败时不恢复当前协程，而是把错误直接交给当前协程的等待者，
+// 一路向上直到某一层是普通的 co_await 为止，整个过程不抛异常
+template<class E>
+struct ExpectedPromiseBase;
+
+template<class E>
+struct ExpectedFinalAwaiter {
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    template<class P>
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<P> coroutine) const noexcept {
+        ExpectedPromiseBase<E> *promise = &coroutine.promise();
+        while (promise->mError && promise->mParent) {
+            auto *parent = promise->mParent;
+            parent->mError.emplace(std::move(*promise->mError));
+            promise = parent;
+        }
+        if (promise->mPrevious)
+            return promise->mPrevious;
+        else
+            return std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {
+    }
+};
+
+template<class E>
+struct ExpectedPromiseBase : FrameProfileHook {
+    ExpectedPromiseBase(std::source_location loc) noexcept
+        : FrameProfileHook(loc) {
+    }
+
+    auto initial_suspend() noexcept {
+        return std::suspend_always();
+    }
+
+    auto final_suspend() noexcept {
+        return ExpectedFinalAwaiter<E>();
+    }
+
+    void unhandled_exception() noexcept {
+        mException = std::current_exception();
+    }
+
+    std::coroutine_handle<> mPrevious{};
+    ExpectedPromiseBase *mParent{}; // 由 try_await 设置，出错时跳过这一层
+    std::exception_ptr mException{};
+    std::optional<E> mError{};
+
+    ExpectedPromiseBase &operator=(ExpectedPromiseBase &&) = delete;
+};
+
+template<class T, class E>
+struct Promise<std::expected<T, E> > : ExpectedPromiseBase<E> {
+    Promise(std::source_location loc = std::source_location::current()) noexcept
+        : ExpectedPromiseBase<E>(loc) {
+    }
+
+    void return_value(std::expected<T, E> &&ret) {
+        if (ret.has_value()) {
+            if constexpr (std::is_void_v<T>) {
+                mResult.putValue(NonVoidHelper<>{});
+            } else {
+                mResult.putValue(std::move(*ret));
+            }
+        } else {
+            this->mError.emplace(std::move(ret).error());
+        }
+    }
+
+    void return_value(std::expected<T, E> const &ret) {
+        return_value(std::expected<T, E>(ret));
+    }
+
+    std::expected<T, E> result() {
+        if (this->mException) [[unlikely]] {
+            std::rethrow_exception(this->mException);
+        }
+        if (this->mError) {
+            return std::unexpected(std::move(*this->mError));
+        }
+        if constexpr (std::is_void_v<T>) {
+            return {};
+        } else {
+            return mResult.moveValue();
+        }
+    }
+
+    auto get_return_object() {
+        return std::coroutine_handle<Promise>::from_promise(*this);
+    }
+
+    Uninitialized<T> mResult;
+};
+
+template<class T, class E>
+struct TryAwaiter {
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    template<std::derived_from<ExpectedPromiseBase<E> > P>
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<P> coroutine) const noexcept {
+        auto &promise = mCoroutine.promise();
+        promise.mPrevious = coroutine;
+        promise.mParent = &coroutine.promise();
+        return mCoroutine;
+    }
+
+    // 只有成功时才会走到这里
+    T await_resume() const {
+        if constexpr (std::is_void_v<T>) {
+            mCoroutine.promise().result();
+        } else {
+            return *mCoroutine.promise().result();
+        }
+    }
+
+    std::coroutine_handle<Promise<std::expected<T, E> > > mCoroutine;
+};
+
+// 只能在同样返回 Task<std::expected<U, E>> 的协程里使用
+template<class T, class E, class P>
+auto try_await(Task<std::expected<T, E>, P> const &task) noexcept {
+    return TryAwaiter<T, E>(task.mCoroutine);
+}
+
+template<class T>
+struct IsExpected : std::false_type {
+};
+
+template<class T, class E>
+struct IsExpected<std::expected<T, E> > : std::true_type {
+    using ValueType = T;
+    using ErrorType = E;
+};
+
+template<class A>
+concept ExpectedAwaitable = Awaitable<A> && IsExpected<typename AwaitableTraits<A>::RetType>::value;
+
+template<class A>
+using ExpectedValueType = IsExpected<typename AwaitableTraits<A>::RetType>::ValueType;
+
+template<class A>
+using ExpectedErrorType = IsExpected<typename AwaitableTraits<A>::RetType>::ErrorType;
+
+template<class E>
+struct WhenExpectedCtlBlock {
+    std::size_t mCount;
+    std::size_t mIndex{0};
+    std::coroutine_handle<> mPrevious{};
+    std::optional<E> mError{};
+};
+
+// 任一子任务返回错误就立即恢复 when_all 的等待者，不再等其他子任务
+template<class T, class E>
+ReturnPreviousTask whenAllExpectedHelper(auto const &t, WhenExpectedCtlBlock<E> &control,
+                                         Uninitialized<T> &result) {
+    auto ret = co_await t;
+    if (!ret.has_value()) {
+        if (control.mError)
+            co_return nullptr;
+        control.mError.emplace(std::move(ret).error());
+        co_return control.mPrevious;
+    }
+    if constexpr (std::is_void_v<T>) {
+        result.putValue(NonVoidHelper<>{});
+    } else {
+        result.putValue(std::move(*ret));
+    }
+    if (--control.mCount == 0 && !control.mError) {
+        co_return control.mPrevious;
+    }
+    co_return nullptr;
+}
+
+struct WhenExpectedAwaiter {
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<> coroutine) const {
+        if (mTasks.empty()) return coroutine;
+        mPrevious = coroutine;
+        for (auto const &t: mTasks.subspan(0, mTasks.size() - 1))
+            t.mCoroutine.resume();
+        return mTasks.back().mCoroutine;
+    }
+
+    void await_resume() const noexcept {
+    }
+
+    std::coroutine_handle<> &mPrevious;
+    std::span<ReturnPreviousTask const> mTasks;
+};
+
+template<class E, std::size_t... Is, class... Ts>
+Task<std::expected<std::tuple<typename NonVoidHelper<ExpectedValueType<Ts> >::Type...>, E> >
+whenAllExpectedImpl(std::index_sequence<Is...>, Ts &&... ts) {
+    WhenExpectedCtlBlock<E> control{sizeof...(Ts)};
+    std::tuple<Uninitialized<ExpectedValueType<Ts> >...> result;
+    ReturnPreviousTask taskArray[]{whenAllExpectedHelper(ts, control, std::get<Is>(result))...};
+    co_await WhenExpectedAwaiter(control.mPrevious, taskArray);
+    if (control.mError) {
+        co_return std::unexpected(std::move(*control.mError));
+    }
+    co_return std::tuple<typename NonVoidHelper<ExpectedValueType<Ts> >::Type...>(
+        std::get<Is>(result).moveValue()...);
+}
+
+// 所有子任务都返回 std::expected<Ti, E> 时，结果是 std::expected<std::tuple<Ti...>, E>
+template<ExpectedAwaitable T0, ExpectedAwaitable... Ts>
+    requires(std::same_as<ExpectedErrorType<T0>, ExpectedErrorType<Ts> > && ...)
+auto when_all(T0 &&t0, Ts &&... ts) {
+    return whenAllExpectedImpl<ExpectedErrorType<T0> >(std::make_index_sequence<1 + sizeof...(Ts)>{},
+                                                       std::forward<T0>(t0), std::forward<Ts>(ts)...);
+}
+
+template<class T, class E>
+ReturnPreviousTask whenAnyExpectedHelper(auto const &t, WhenExpectedCtlBlock<E> &control,
+                                         Uninitialized<T> &result, std::size_t index) {
+    auto ret = co_await t;
+    if (!ret.has_value()) {
+        control.mError.emplace(std::move(ret).error());
+    } else if constexpr (std::is_void_v<T>) {
+        result.putValue(NonVoidHelper<>{});
+    } else {
+        result.putValue(std::move(*ret));
+    }
+    control.mIndex = index;
+    co_return control.mPrevious;
+}
+
+template<class E, std::size_t... Is, class... Ts>
+Task<std::expected<std::variant<typename NonVoidHelper<ExpectedValueType<Ts> >::Type...>, E> >
+whenAnyExpectedImpl(std::index_sequence<Is...>, Ts &&... ts) {
+    WhenExpectedCtlBlock<E> control{0};
+    std::tuple<Uninitialized<ExpectedValueType<Ts> >...> result;
+    ReturnPreviousTask taskArray[]{whenAnyExpectedHelper(ts, control, std::get<Is>(result), Is)...};
+    co_await WhenExpectedAwaiter(control.mPrevious, taskArray);
+    if (control.mError) {
+        co_return std::unexpected(std::move(*control.mError));
+    }
+    Uninitialized<std::variant<typename NonVoidHelper<ExpectedValueType<Ts> >::Type...> > varResult;
+    ((control.mIndex == Is && (varResult.putValue(
+                                   std::in_place_index<Is>, std::get<Is>(result).moveValue()), 0)), ...);
+    co_return varResult.moveValue();
+}
+
+// 第一个完成的子任务决定结果：成功则是它的值，失败则是它的错误
+template<ExpectedAwaitable T0, ExpectedAwaitable... Ts>
+    requires(std::same_as<ExpectedErrorType<T0>, ExpectedErrorType<Ts> > && ...)
+auto when_any(T0 &&t0, Ts &&... ts) {
+    return whenAnyExpectedImpl<ExpectedErrorType<T0> >(std::make_index_sequence<1 + sizeof...(Ts)>{},
+                                                       std::forward<T0>(t0), std::forward<Ts>(ts)...);
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <source_location>
+
+#if CORO_PROFILE_FRAMES
+
+#include <algorithm>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 统计每个协程函数的帧大小与分配次数：
+// 每次调用协程都会构造 promise，只有没被编译器消除（HALO）的那些才会经过 promise 的 operator new
+struct FrameProfiler {
+    struct Stats {
+        char const *mFunction{};
+        char const *mFile{};
+        unsigned mLine{};
+        std::size_t mFrames{};
+        std::size_t mHeapFrames{};
+        std::size_t mHeapBytes{};
+        std::size_t mFrameSize{};
+        std::size_t mLiveBytes{};
+        std::size_t mPeakLiveBytes{};
+    };
+
+    static FrameProfiler &instance() {
+        static FrameProfiler profiler;
+        return profiler;
+    }
+
+    void onPromise(std::source_location const &loc) {
+        std::lock_guard lock(mMutex);
+        ++statsFor(loc).mFrames;
+    }
+
+    void *allocate(std::size_t size, std::source_location const &loc) {
+        // 帧前面留一个头保存统计项，释放时才知道归还给谁
+        auto *block = static_cast<std::byte *>(::operator new(size + kHeaderSize));
+        std::lock_guard lock(mMutex);
+        auto &stats = statsFor(loc);
+        ++stats.mHeapFrames;
+        stats.mHeapBytes += size;
+        stats.mFrameSize = std::max(stats.mFrameSize, size);
+        stats.mLiveBytes += size;
+        stats.mPeakLiveBytes = std::max(stats.mPeakLiveBytes, stats.mLiveBytes);
+        *reinterpret_cast<Stats **>(block) = &stats;
+        return block + kHeaderSize;
+    }
+
+    void deallocate(void *ptr, std::size_t size) noexcept {
+        auto *block = static_cast<std::byte *>(ptr) - kHeaderSize;
+        {
+            std::lock_guard lock(mMutex);
+            (*reinterpret_cast<Stats **>(block))->mLiveBytes -= size;
+        }
+        ::operator delete(block, size + kHeaderSize);
+    }
+
+    // 按累计堆分配字节数从大到小输出
+    void report(std::ostream &os = std::cerr) {
+        std::vector<Stats> rows;
+        {
+            std::lock_guard lock(mMutex);
+            for (auto const &[key, stats]: mStats)
+                rows.push_back(stats);
+        }
+        std::sort(rows.begin(), rows.end(), [](Stats const &lhs, Stats const &rhs) {
+            return lhs.mHeapBytes > rhs.mHeapBytes;
+        });
+        auto flags = os.flags();
+        os << std::left << std::setw(10) << "frames" << std::setw(10) << "heap"
+           << std::setw(10) << "elided" << std::setw(10) << "size"
+           << std::setw(12) << "peak live" << std::setw(12) << "total"
+           << "coroutine\n";
+        for (auto const &row: rows) {
+            os << std::setw(10) << row.mFrames << std::setw(10) << row.mHeapFrames
+               << std::setw(10) << (row.mFrames - std::min(row.mFrames, row.mHeapFrames))
+               << std::setw(10) << row.mFrameSize << std::setw(12) << row.mPeakLiveBytes
+               << std::setw(12) << row.mHeapBytes
+               << row.mFunction << " (" << row.mFile << ':' << row.mLine << ")\n";
+        }
+        os.flags(flags);
+    }
+
+private:
+    static constexpr std::size_t kHeaderSize = alignof(std::max_align_t);
+
+    Stats &statsFor(std::source_location const &loc) {
+        auto &stats = mStats[std::string(loc.function_name()) + '@' + std::to_string(loc.line())];
+        if (!stats.mFunction) {
+            stats.mFunction = loc.function_name();
+            stats.mFile = loc.file_name();
+            stats.mLine = loc.line();
+        }
+        return stats;
+    }
+
+    std::mutex mMutex;
+    std::unordered_map<std::string, Stats> mStats;
+};
+
+// promise 类型继承它：构造函数和 operator new 的默认参数 source_location::current()
+// 在协程函数里求值，因此记到的是协程函数本身的位置
+struct FrameProfileHook {
+    FrameProfileHook(std::source_location loc = std::source_location::current()) {
+        FrameProfiler::instance().onPromise(loc);
+    }
+
+    static void *operator new(std::size_t size,
+                              std::source_location loc = std::source_location::current()) {
+        return FrameProfiler::instance().allocate(size, loc);
+    }
+
+    static void operator delete(void *ptr, std::size_t size) noexcept {
+        FrameProfiler::instance().deallocate(ptr, size);
+    }
+};
+
+#else
+
+struct FrameProfileHook {
+    FrameProfileHook(std::source_location = std::source_location::current()) noexcept {
+    }
+};
+
+#endif
@@ -0,0 +1,80 @@
+#pragma once
+
+#if !defined(__linux__)
+#error "io.h requires epoll (Linux)"
+#endif
+
+#include <cerrno>
+#include <span>
+#include <string>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include "coro.h"
+
+struct IoAwaiter : Loop::IoWaiter {
+    IoAwaiter(Loop &loop, int fd, std::uint32_t events) noexcept
+        : Loop::IoWaiter{fd}, mLoop(loop), mEvents(events) {
+    }
+
+    IoAwaiter(IoAwaiter &&) = delete;
+
+    // 等待期间所在的协程被销毁（例如 when_any 的另一支先完成）时，从 epoll 上摘下来
+    ~IoAwaiter() {
+        mLoop.removeIoWaiter(*this);
+    }
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> coroutine) {
+        mCoroutine = coroutine;
+        mLoop.addIoWaiter(*this, mEvents);
+    }
+
+    void await_resume() const noexcept {
+    }
+
+    Loop &mLoop;
+    std::uint32_t mEvents;
+};
+
+inline IoAwaiter wait_readable(int fd) {
+    return IoAwaiter(getLoop(), fd, EPOLLIN);
+}
+
+inline IoAwaiter wait_writable(int fd) {
+    return IoAwaiter(getLoop(), fd, EPOLLOUT);
+}
+
+inline void set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) [[unlikely]] {
+        throw std::system_error(errno, std::system_category(), "fcntl");
+    }
+}
+
+// fd 必须是非阻塞的；返回 0 表示读到了文件末尾
+inline Task<std::size_t> async_read(int fd, std::span<char> buffer) {
+    while (true) {
+        ssize_t n = ::read(fd, buffer.data(), buffer.size());
+        if (n >= 0)
+            co_return std::size_t(n);
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            co_await wait_readable(fd);
+        } else if (errno != EINTR) [[unlikely]] {
+            throw std::system_error(errno, std::system_category(), "read");
+        }
+    }
+}
+
+// 一直读到文件末尾
+inline Task<std::string> async_read_all(int fd) {
+    std::string result;
+    char buffer[4096];
+    while (std::size_t n = co_await async_read(fd, buffer))
+        result.append(buffer, n);
+    co_return result;
+}
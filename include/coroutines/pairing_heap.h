@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+// 侵入式配对堆：Value 继承 PairingHeap::Node，接口与 RbTree 相同（insert/erase/front/empty）
+// insert 和 front 是 O(1)，erase 均摊 O(log n)；相等的元素之间不保证先进先出
+template <class Value, class Compare = std::less<Value>>
+struct PairingHeap {
+    struct Node {
+        Node() noexcept = default;
+
+        Node(Node &&) = delete;
+
+        ~Node() noexcept {
+            if (heap) {
+                heap->doErase(this);
+            }
+        }
+
+        friend struct PairingHeap;
+
+    private:
+        Node *child{nullptr}; // 第一个孩子
+        Node *next{nullptr};  // 下一个兄弟
+        Node *prev{nullptr};  // 上一个兄弟；第一个孩子指向父节点，根为空
+        PairingHeap *heap{nullptr};
+    };
+
+private:
+    Node *root;
+    std::size_t count;
+    Compare comp;
+
+    bool compare(Node *left, Node *right) const noexcept {
+        return comp(static_cast<Value &>(*left), static_cast<Value &>(*right));
+    }
+
+    // 两个根合并，较大的成为较小者的第一个孩子；调用者负责两者的 prev/next
+    Node *meld(Node *first, Node *second) noexcept {
+        if (compare(second, first)) {
+            std::swap(first, second);
+        }
+        second->prev = first;
+        second->next = first->child;
+        if (first->child != nullptr) {
+            first->child->prev = second;
+        }
+        first->child = second;
+        return first;
+    }
+
+    // 经典的两趟合并：从左到右两两合并，再从右到左依次并入
+    Node *mergePairs(Node *first) noexcept {
+        if (first == nullptr) {
+            return nullptr;
+        }
+
+        Node *pairs = nullptr; // 第一趟的结果，借用 next 串成逆序链表
+        while (first != nullptr) {
+            Node *second = first->next;
+            Node *rest = second ? second->next : nullptr;
+            first->next = nullptr;
+            Node *merged = first;
+            if (second != nullptr) {
+                second->next = nullptr;
+                merged = meld(first, second);
+            }
+            merged->next = pairs;
+            pairs = merged;
+            first = rest;
+        }
+
+        Node *result = pairs;
+        pairs = pairs->next;
+        result->next = nullptr;
+        while (pairs != nullptr) {
+            Node *nextPair = pairs->next;
+            pairs->next = nullptr;
+            result = meld(pairs, result);
+            pairs = nextPair;
+        }
+        result->prev = nullptr;
+        return result;
+    }
+
+    void doInsert(Node *node) noexcept {
+        node->child = nullptr;
+        node->next = nullptr;
+        node->prev = nullptr;
+        node->heap = this;
+        root = root ? meld(root, node) : node;
+        ++count;
+    }
+
+    void doErase(Node *node) noexcept {
+        node->heap = nullptr;
+        --count;
+
+        if (node == root) {
+            root = mergePairs(node->child);
+            return;
+        }
+
+        // 从兄弟链表上摘下来，孩子们合并成一棵后再并回根
+        if (node->prev->child == node) {
+            node->prev->child = node->next;
+        } else {
+            node->prev->next = node->next;
+        }
+        if (node->next != nullptr) {
+            node->next->prev = node->prev;
+        }
+        node->next = nullptr;
+        node->prev = nullptr;
+
+        if (Node *subtree = mergePairs(node->child)) {
+            root = meld(root, subtree);
+        }
+    }
+
+public:
+    PairingHeap() noexcept : root(nullptr), count(0) {}
+
+    explicit PairingHeap(Compare comp) noexcept(noexcept(Compare(comp)))
+        : root(nullptr),
+          count(0),
+          comp(comp) {}
+
+    PairingHeap(PairingHeap &&) = delete;
+
+    ~PairingHeap() noexcept {}
+
+    void insert(Value &value) noexcept {
+        doInsert(&static_cast<Node &>(value));
+    }
+
+    void erase(Value &value) noexcept {
+        doErase(&static_cast<Node &>(value));
+    }
+
+    bool empty() const noexcept {
+        return root == nullptr;
+    }
+
+    std::size_t size() const noexcept {
+        return count;
+    }
+
+    Value &front() const noexcept {
+        return static_cast<Value &>(*root);
+    }
+};
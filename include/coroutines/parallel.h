@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <vector>
+#include "coro.h"
+#include "thread_pool.h"
+
+// 把 mView 切成每块 mGrain 个元素，全部提交到线程池后挂起；最后一个完成的块把协程交还给 Loop
+// 某一块抛出异常后，尚未开始的块直接跳过
+template<class V, class F>
+struct ParallelForAwaiter {
+    ParallelForAwaiter(V view, std::size_t grain, F func, ThreadPool &pool, Loop &loop)
+        : mView(std::move(view)), mGrain(grain == 0 ? 1 : grain),
+          mFunc(std::move(func)), mPool(pool), mLoop(loop) {
+        mChunks = (std::ranges::size(mView) + mGrain - 1) / mGrain;
+    }
+
+    ParallelForAwaiter(ParallelForAwaiter &&) = delete;
+
+    bool await_ready() const noexcept {
+        return mChunks == 0;
+    }
+
+    void await_suspend(std::coroutine_handle<> coroutine) {
+        mCoroutine = coroutine;
+        mRemaining.store(mChunks, std::memory_order_relaxed);
+        mLoop.expectRemote();
+        for (std::size_t chunk = 0; chunk < mChunks; ++chunk)
+            mPool.submit([this, chunk] { runChunk(chunk); });
+    }
+
+    void await_resume() const {
+        if (mException) [[unlikely]] {
+            std::rethrow_exception(mException);
+        }
+    }
+
+private:
+    void runChunk(std::size_t chunk) {
+        if (!mFailed.load(std::memory_order_relaxed)) {
+            try {
+                using Diff = std::ranges::range_difference_t<V>;
+                std::size_t size = std::ranges::size(mView);
+                auto first = std::ranges::begin(mView) + static_cast<Diff>(chunk * mGrain);
+                auto last = std::ranges::begin(mView) + static_cast<Diff>(std::min(size, (chunk + 1) * mGrain));
+                for (; first != last; ++first)
+                    std::invoke(mFunc, *first);
+            } catch (...) {
+                if (!mFailed.exchange(true, std::memory_order_relaxed))
+                    mException = std::current_exception();
+            }
+        }
+        if (mRemaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            mLoop.postTask(mCoroutine);
+    }
+
+    V mView;
+    std::size_t mGrain;
+    std::size_t mChunks;
+    F mFunc;
+    ThreadPool &mPool;
+    Loop &mLoop;
+    std::coroutine_handle<> mCoroutine{};
+    std::atomic<std::size_t> mRemaining{0};
+    std::atomic<bool> mFailed{false};
+    std::exception_ptr mException{};
+};
+
+// co_await parallel_for(range, grain, fn) 对 range 的每个元素调用 fn，元素之间没有顺序保证
+template<std::ranges::random_access_range R, class F>
+    requires std::ranges::sized_range<R>
+auto parallel_for(R &&range, std::size_t grain, F func, ThreadPool &pool = getThreadPool()) {
+    using V = std::views::all_t<R>;
+    return ParallelForAwaiter<V, F>(std::views::all(std::forward<R>(range)), grain,
+                                    std::move(func), pool, getLoop());
+}
+
+// 每块先各自归约，再在 Loop 线程上按块的顺序与 init 合并，所以 op 只需满足结合律
+template<std::ranges::random_access_range R, class T, class Op = std::plus<> >
+    requires std::ranges::sized_range<R>
+Task<T> parallel_reduce(R &&range, std::size_t grain, T init, Op op = {},
+                        ThreadPool &pool = getThreadPool()) {
+    using Diff = std::ranges::range_difference_t<R>;
+    grain = grain == 0 ? 1 : grain;
+    std::size_t size = std::ranges::size(range);
+    std::size_t chunks = (size + grain - 1) / grain;
+    std::vector<std::optional<T> > partials(chunks);
+    co_await parallel_for(std::views::iota(std::size_t(0), chunks), 1, [&](std::size_t chunk) {
+        auto first = std::ranges::begin(range) + static_cast<Diff>(chunk * grain);
+        auto last = std::ranges::begin(range) + static_cast<Diff>(std::min(size, (chunk + 1) * grain));
+        T acc(*first);
+        for (++first; first != last; ++first)
+            acc = std::invoke(op, std::move(acc), *first);
+        partials[chunk].emplace(std::move(acc));
+    }, pool);
+    for (auto &partial: partials)
+        init = std::invoke(op, std::move(init), std::move(*partial));
+    co_return init;
+}
+
+inline constexpr std::size_t kParallelSortGrain = 4096;
+
+// 先把 range 切成若干块并行排序，再一轮轮两两并行归并
+template<std::ranges::random_access_range R, class Compare = std::ranges::less>
+    requires std::ranges::sized_range<R> && std::sortable<std::ranges::iterator_t<R>, Compare>
+Task<void> parallel_sort(R &&range, Compare comp = {}, ThreadPool &pool = getThreadPool()) {
+    using Diff = std::ranges::range_difference_t<R>;
+    std::size_t size = std::ranges::size(range);
+    std::size_t chunks = std::min(pool.size(), (size + kParallelSortGrain - 1) / kParallelSortGrain);
+    if (chunks <= 1) {
+        std::ranges::sort(range, comp);
+        co_return;
+    }
+    auto first = std::ranges::begin(range);
+    auto bound = [&](std::size_t chunk) {
+        return first + static_cast<Diff>(std::min(size, chunk * ((size + chunks - 1) / chunks)));
+    };
+    co_await parallel_for(std::views::iota(std::size_t(0), chunks), 1, [&](std::size_t chunk) {
+        std::sort(bound(chunk), bound(chunk + 1), comp);
+    }, pool);
+    for (std::size_t width = 1; width < chunks; width *= 2) {
+        std::size_t pairs = (chunks + 2 * width - 1) / (2 * width);
+        co_await parallel_for(std::views::iota(std::size_t(0), pairs), 1, [&](std::size_t pair) {
+            std::size_t lo = pair * 2 * width;
+            std::size_t mid = std::min(chunks, lo + width);
+            std::size_t hi = std::min(chunks, lo + 2 * width);
+            std::inplace_merge(bound(lo), bound(mid), bound(hi), comp);
+        }, pool);
+    }
+}
@@ -0,0 +1,396 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "coro.h"
+#include "thread_pool.h"
+
+// 容量有限的单线程通道：满了 push 挂起，空了 pop 挂起，被挂起的一方由 Loop 重新调度
+template<class T>
+struct Channel {
+    explicit Channel(std::size_t capacity, Loop &loop = getLoop())
+        : mCapacity(capacity), mLoop(loop) {
+    }
+
+    Channel(Channel &&) = delete;
+
+    struct PushAwaiter {
+        bool await_ready() {
+            if (mChannel.mClosed) {
+                return true;
+            }
+            if (!mChannel.mPoppers.empty()) {
+                auto *popper = mChannel.mPoppers.front();
+                mChannel.mPoppers.pop_front();
+                popper->mValue.emplace(std::move(mValue));
+                mChannel.mLoop.addTask(popper->mCoroutine);
+                mAccepted = true;
+                return true;
+            }
+            if (mChannel.mBuffer.size() < mChannel.mCapacity) {
+                mChannel.mBuffer.push_back(std::move(mValue));
+                mAccepted = true;
+                return true;
+            }
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> coroutine) {
+            mCoroutine = coroutine;
+            mChannel.mPushers.push_back(this);
+        }
+
+        // 返回 false 表示通道已关闭，值被丢弃
+        bool await_resume() const noexcept {
+            return mAccepted;
+        }
+
+        Channel &mChannel;
+        T mValue;
+        bool mAccepted{false};
+        std::coroutine_handle<> mCoroutine{};
+    };
+
+    struct PopAwaiter {
+        bool await_ready() {
+            if (!mChannel.mBuffer.empty()) {
+                mValue.emplace(std::move(mChannel.mBuffer.front()));
+                mChannel.mBuffer.pop_front();
+                mChannel.admitPusher();
+                return true;
+            }
+            if (!mChannel.mPushers.empty()) {
+                auto *pusher = mChannel.mPushers.front();
+                mChannel.mPushers.pop_front();
+                mValue.emplace(std::move(pusher->mValue));
+                pusher->mAccepted = true;
+                mChannel.mLoop.addTask(pusher->mCoroutine);
+                return true;
+            }
+            return mChannel.mClosed;
+        }
+
+        void await_suspend(std::coroutine_handle<> coroutine) {
+            mCoroutine = coroutine;
+            mChannel.mPoppers.push_back(this);
+        }
+
+        // 返回 nullopt 表示通道已关闭且没有剩余数据
+        std::optional<T> await_resume() {
+            return std::move(mValue);
+        }
+
+        Channel &mChannel;
+        std::optional<T> mValue{};
+        std::coroutine_handle<> mCoroutine{};
+    };
+
+    PushAwaiter push(T value) {
+        return PushAwaiter(*this, std::move(value));
+    }
+
+    PopAwaiter pop() {
+        return PopAwaiter(*this);
+    }
+
+    // 关闭后 push 立即返回 false，pop 取完缓冲区后返回 nullopt
+    void close() {
+        if (mClosed)
+            return;
+        mClosed = true;
+        for (auto *popper: mPoppers)
+            mLoop.addTask(popper->mCoroutine);
+        mPoppers.clear();
+        for (auto *pusher: mPushers)
+            mLoop.addTask(pusher->mCoroutine);
+        mPushers.clear();
+    }
+
+    bool closed() const noexcept {
+        return mClosed;
+    }
+
+    Channel &operator=(Channel &&) = delete;
+
+private:
+    void admitPusher() {
+        if (mPushers.empty())
+            return;
+        auto *pusher = mPushers.front();
+        mPushers.pop_front();
+        mBuffer.push_back(std::move(pusher->mValue));
+        pusher->mAccepted = true;
+        mLoop.addTask(pusher->mCoroutine);
+    }
+
+    std::size_t mCapacity;
+    Loop &mLoop;
+    bool mClosed{false};
+    std::deque<T> mBuffer{};
+    std::deque<PushAwaiter *> mPushers{};
+    std::deque<PopAwaiter *> mPoppers{};
+};
+
+inline constexpr std::size_t kPipelineCapacity = 64;
+
+// 任一阶段抛出异常时记录下来，并关闭该阶段的输入输出，让上下游自然退出
+struct PipelineCtlBlock {
+    std::exception_ptr mException{};
+
+    template<class In, class Out>
+    void fail(Channel<In> &in, Channel<Out> &out) {
+        if (!mException)
+            mException = std::current_exception();
+        in.close();
+        out.close();
+    }
+};
+
+template<class R>
+struct FromStage {
+    using ValueType = std::remove_cvref_t<std::ranges::range_reference_t<R const> >;
+
+    Task<void> run(Channel<ValueType> &out, PipelineCtlBlock &) const {
+        for (auto const &value: mRange)
+            if (!co_await out.push(value))
+                break;
+        out.close();
+    }
+
+    R mRange;
+};
+
+// 源头：逐个读出 mRange 的元素
+template<class R>
+auto from(R range) {
+    return FromStage<R>{std::move(range)};
+}
+
+template<class G>
+struct GenerateStage {
+    using ValueType = std::invoke_result_t<G &>::value_type;
+
+    Task<void> run(Channel<ValueType> &out, PipelineCtlBlock &ctl) {
+        try {
+            while (auto value = mGen()) {
+                if (!co_await out.push(std::move(*value)))
+                    break;
+            }
+        } catch (...) {
+            ctl.fail(out, out);
+        }
+        out.close();
+    }
+
+    G mGen;
+};
+
+// 源头：反复调用 gen()，直到它返回 nullopt
+template<class G>
+auto generate(G gen) {
+    return GenerateStage<G>{std::move(gen)};
+}
+
+template<class F>
+struct MapStage {
+    template<class In>
+    using Output = std::remove_cvref_t<std::invoke_result_t<F &, In> >;
+
+    template<class In>
+    Task<void> worker(Channel<In> &in, Channel<Output<In> > &out, PipelineCtlBlock &ctl) {
+        try {
+            while (auto value = co_await in.pop()) {
+                if (mPool) {
+                    auto result = co_await offload(*mPool, [this, &value] {
+                        return std::invoke(mFunc, std::move(*value));
+                    });
+                    if (!co_await out.push(std::move(result)))
+                        break;
+                } else {
+                    if (!co_await out.push(std::invoke(mFunc, std::move(*value))))
+                        break;
+                }
+            }
+        } catch (...) {
+            ctl.fail(in, out);
+        }
+    }
+
+    template<class In>
+    Task<void> process(Channel<In> &in, Channel<Output<In> > &out, PipelineCtlBlock &ctl) {
+        if (mConcurrency <= 1) {
+            co_await worker(in, out, ctl);
+        } else {
+            std::vector<Task<void> > workers;
+            workers.reserve(mConcurrency);
+            for (std::size_t i = 0; i < mConcurrency; ++i)
+                workers.push_back(worker(in, out, ctl));
+            co_await when_all(workers);
+        }
+        in.close();
+        out.close();
+    }
+
+    MapStage buffer(std::size_t capacity) && {
+        mCapacity = capacity;
+        return std::move(*this);
+    }
+
+    F mFunc;
+    ThreadPool *mPool{nullptr};
+    std::size_t mConcurrency{1};
+    std::size_t mCapacity{kPipelineCapacity};
+};
+
+template<class F>
+auto map(F func) {
+    return MapStage<F>{std::move(func)};
+}
+
+// 在线程池上并行执行 func，最多 concurrency 个元素同时在途，输出顺序不保证与输入一致
+template<class F>
+auto map(F func, ThreadPool &pool, std::size_t concurrency) {
+    return MapStage<F>{std::move(func), &pool, concurrency};
+}
+
+template<class P>
+struct FilterStage {
+    template<class In>
+    using Output = In;
+
+    template<class In>
+    Task<void> process(Channel<In> &in, Channel<In> &out, PipelineCtlBlock &ctl) {
+        try {
+            while (auto value = co_await in.pop()) {
+                if (!std::invoke(mPred, std::as_const(*value)))
+                    continue;
+                if (!co_await out.push(std::move(*value)))
+                    break;
+            }
+        } catch (...) {
+            ctl.fail(in, out);
+        }
+        in.close();
+        out.close();
+    }
+
+    FilterStage buffer(std::size_t capacity) && {
+        mCapacity = capacity;
+        return std::move(*this);
+    }
+
+    P mPred;
+    std::size_t mCapacity{kPipelineCapacity};
+};
+
+template<class P>
+auto filter(P pred) {
+    return FilterStage<P>{std::move(pred)};
+}
+
+struct BatchStage {
+    template<class In>
+    using Output = std::vector<In>;
+
+    // 攒满 mSize 个元素才往下游发，输入结束时把不足一批的剩余部分也发出去
+    template<class In>
+    Task<void> process(Channel<In> &in, Channel<std::vector<In> > &out, PipelineCtlBlock &ctl) {
+        try {
+            std::vector<In> batch;
+            batch.reserve(mSize);
+            while (auto value = co_await in.pop()) {
+                batch.push_back(std::move(*value));
+                if (batch.size() >= mSize) {
+                    if (!co_await out.push(std::exchange(batch, {})))
+                        break;
+                    batch.reserve(mSize);
+                }
+            }
+            if (!batch.empty())
+                co_await out.push(std::move(batch));
+        } catch (...) {
+            ctl.fail(in, out);
+        }
+        in.close();
+        out.close();
+    }
+
+    BatchStage buffer(std::size_t capacity) && {
+        mCapacity = capacity;
+        return std::move(*this);
+    }
+
+    std::size_t mSize;
+    std::size_t mCapacity{kPipelineCapacity};
+};
+
+inline BatchStage batch(std::size_t size) {
+    return BatchStage{size == 0 ? 1 : size};
+}
+
+template<class F>
+struct SinkStage {
+    template<class In>
+    Task<void> process(Channel<In> &in, PipelineCtlBlock &ctl) {
+        try {
+            while (auto value = co_await in.pop())
+                std::invoke(mFunc, std::move(*value));
+        } catch (...) {
+            ctl.fail(in, in);
+        }
+        in.close();
+    }
+
+    SinkStage buffer(std::size_t capacity) && {
+        mCapacity = capacity;
+        return std::move(*this);
+    }
+
+    F mFunc;
+    std::size_t mCapacity{kPipelineCapacity};
+};
+
+template<class F>
+auto sink(F func) {
+    return SinkStage<F>{std::move(func)};
+}
+
+// 上游 mPrev 与阶段 mStage 之间隔着一个容量为 mStage.mCapacity 的通道
+template<class Prev, class Stage>
+struct ChainStage {
+    using ValueType = Stage::template Output<typename Prev::ValueType>;
+
+    Task<void> run(Channel<ValueType> &out, PipelineCtlBlock &ctl) {
+        Channel<typename Prev::ValueType> mid(mStage.mCapacity);
+        co_await when_all(mPrev.run(mid, ctl), mStage.process(mid, out, ctl));
+    }
+
+    Prev mPrev;
+    Stage mStage;
+};
+
+template<class Flow>
+concept PipelineFlow = requires { typename Flow::ValueType; };
+
+template<PipelineFlow Prev, class Stage>
+    requires requires { typename Stage::template Output<typename Prev::ValueType>; }
+auto operator|(Prev prev, Stage stage) {
+    return ChainStage<Prev, Stage>{std::move(prev), std::move(stage)};
+}
+
+// 接上 sink 之后整条流水线就是一个 Task，co_await 它会一直运行到数据耗尽
+template<PipelineFlow Prev, class F>
+Task<void> operator|(Prev prev, SinkStage<F> sink) {
+    PipelineCtlBlock ctl;
+    Channel<typename Prev::ValueType> mid(sink.mCapacity);
+    co_await when_all(prev.run(mid, ctl), sink.process(mid, ctl));
+    if (ctl.mException) [[unlikely]] {
+        std::rethrow_exception(ctl.mException);
+    }
+}
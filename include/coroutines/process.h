@@ -0,0 +1,149 @@
+#pragma once
+
+#if !defined(__linux__)
+#error "process.h requires pidfd (Linux)"
+#endif
+
+#include <cerrno>
+#include <csignal>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "coro.h"
+#include "io.h"
+
+extern char **environ;
+
+// 子进程句柄：标准输出和标准错误是非阻塞管道，退出状态通过 pidfd 在 Loop 上等待
+// 两个管道要同时读（例如 when_all），否则子进程可能因为其中一个写满而卡住
+struct Process {
+    Process() = default;
+
+    Process(Process &&that) noexcept
+        : mPid(std::exchange(that.mPid, -1)),
+          mPidFd(std::exchange(that.mPidFd, -1)),
+          mStdout(std::exchange(that.mStdout, -1)),
+          mStderr(std::exchange(that.mStderr, -1)),
+          mExitStatus(that.mExitStatus) {
+    }
+
+    Process &operator=(Process &&) = delete;
+
+    // 没等到退出就析构时杀掉子进程并回收，避免留下僵尸进程
+    ~Process() {
+        if (mPid != -1 && !mExitStatus) {
+            ::kill(mPid, SIGKILL);
+            ::waitpid(mPid, nullptr, 0);
+        }
+        for (int fd: {mPidFd, mStdout, mStderr})
+            if (fd != -1)
+                ::close(fd);
+    }
+
+    Task<std::size_t> readStdout(std::span<char> buffer) const {
+        return async_read(mStdout, buffer);
+    }
+
+    Task<std::size_t> readStderr(std::span<char> buffer) const {
+        return async_read(mStderr, buffer);
+    }
+
+    Task<std::string> readAllStdout() const {
+        return async_read_all(mStdout);
+    }
+
+    Task<std::string> readAllStderr() const {
+        return async_read_all(mStderr);
+    }
+
+    // 返回与 waitpid 相同编码的状态，用 WIFEXITED/WEXITSTATUS 等宏解读
+    Task<int> wait() {
+        while (!mExitStatus) {
+            int status;
+            pid_t pid = ::waitpid(mPid, &status, WNOHANG);
+            if (pid == mPid) {
+                mExitStatus = status;
+            } else if (pid == 0) {
+                co_await wait_readable(mPidFd);
+            } else if (errno != EINTR) [[unlikely]] {
+                throw std::system_error(errno, std::system_category(), "waitpid");
+            }
+        }
+        co_return *mExitStatus;
+    }
+
+    pid_t pid() const noexcept {
+        return mPid;
+    }
+
+    pid_t mPid{-1};
+    int mPidFd{-1};
+    int mStdout{-1};
+    int mStderr{-1};
+    std::optional<int> mExitStatus{};
+};
+
+// 按 PATH 查找 argv[0] 并启动，子进程继承标准输入
+inline Task<Process> spawn_process(std::vector<std::string> argv) {
+    if (argv.empty()) [[unlikely]] {
+        throw std::invalid_argument("spawn_process: empty argv");
+    }
+    auto check = [](int ret, char const *what) {
+        if (ret != 0) [[unlikely]] {
+            throw std::system_error(ret == -1 ? errno : ret, std::system_category(), what);
+        }
+    };
+
+    Process process;
+    int outPipe[2] = {-1, -1};
+    int errPipe[2] = {-1, -1};
+    auto closePipes = [&] {
+        for (int fd: {outPipe[0], outPipe[1], errPipe[0], errPipe[1]})
+            if (fd != -1)
+                ::close(fd);
+    };
+    try {
+        check(::pipe2(outPipe, O_CLOEXEC), "pipe2");
+        check(::pipe2(errPipe, O_CLOEXEC), "pipe2");
+
+        posix_spawn_file_actions_t actions;
+        check(posix_spawn_file_actions_init(&actions), "posix_spawn_file_actions_init");
+        posix_spawn_file_actions_adddup2(&actions, outPipe[1], STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, errPipe[1], STDERR_FILENO);
+
+        std::vector<char *> args;
+        for (auto &arg: argv)
+            args.push_back(arg.data());
+        args.push_back(nullptr);
+
+        pid_t pid;
+        int ret = posix_spawnp(&pid, args[0], &actions, nullptr, args.data(), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        check(ret, "posix_spawnp");
+        process.mPid = pid;
+
+        ::close(std::exchange(outPipe[1], -1));
+        ::close(std::exchange(errPipe[1], -1));
+        process.mStdout = std::exchange(outPipe[0], -1);
+        process.mStderr = std::exchange(errPipe[0], -1);
+        set_nonblocking(process.mStdout);
+        set_nonblocking(process.mStderr);
+
+        process.mPidFd = int(::syscall(SYS_pidfd_open, pid, 0));
+        if (process.mPidFd == -1) [[unlikely]] {
+            throw std::system_error(errno, std::system_category(), "pidfd_open");
+        }
+    } catch (...) {
+        closePipes();
+        throw;
+    }
+    co_return process;
+}
@@ -1,155 +1,406 @@
 #pragma once
 
+#include <bit>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <iterator>
+#include <ranges>
+#include <type_traits>
 #include <utility>
 
-template <class Value, class Compare = std::less<Value>>
+// 节点布局策略：
+// PackColor 把颜色放进 parent 指针的最低位（节点按指针对齐，这一位总是 0）
+// AutoUnlink 为每个节点保存所属的树，节点析构时自动从树里摘掉；关掉后必须先 erase 再析构
+template <bool PackColor, bool AutoUnlink>
+struct RbNodePolicy {
+    static constexpr bool packColor = PackColor;
+    static constexpr bool autoUnlink = AutoUnlink;
+};
+
+using RbWideNode = RbNodePolicy<false, true>;    // 40 字节
+using RbPackedNode = RbNodePolicy<true, true>;   // 32 字节
+using RbCompactNode = RbNodePolicy<true, false>; // 24 字节
+
+// 子树聚合值（augment）：每个节点额外保存一个由自身和左右孩子的聚合值算出来的值，
+// 树在插入、删除、旋转和批量操作时自底向上维护它。自定义的 augment 提供
+//     using type = ...;
+//     static void update(type &self, Value const &value, type const *left, type const *right);
+// 孩子为空时对应的指针为空
+struct RbNoAugment {};
+
+// 子树节点数，用于 rank/select
+struct RbSubtreeSize {
+    using type = std::size_t;
+
+    template <class Value>
+    static void update(type &self, Value const &, type const *left, type const *right) noexcept {
+        self = 1 + (left ? *left : 0) + (right ? *right : 0);
+    }
+};
+
+// 子树中区间右端点的最大值，用于区间重叠查询（区间树）
+// Value 提供 low() 和 high()（闭区间），树必须按 low() 排序
+template <class T>
+struct RbMaxEnd {
+    using type = T;
+
+    template <class Value>
+    static void update(type &self, Value const &value, type const *left, type const *right) {
+        self = value.high();
+        if (left && self < *left) {
+            self = *left;
+        }
+        if (right && self < *right) {
+            self = *right;
+        }
+    }
+};
+
+template <class Augment>
+inline constexpr bool isRbMaxEnd = false;
+
+template <class T>
+inline constexpr bool isRbMaxEnd<RbMaxEnd<T>> = true;
+
+// 侵入式红黑树：Value 继承 RbTree::RbNode，树本身不分配内存
+// 相等的元素按插入顺序排列；最小、最大节点和元素个数都有缓存，front/back/size 是 O(1)
+template <class Value, class Compare = std::less<Value>, class Policy = RbWideNode,
+          class Augment = RbNoAugment>
 struct RbTree {
+    static constexpr bool hasAugment = !std::is_same_v<Augment, RbNoAugment>;
+
     enum RbColor {
         RED,
         BLACK
     };
 
     struct RbNode {
-        RbNode() noexcept
-            : left(nullptr),
-              right(nullptr),
-              parent(nullptr),
-              tree(nullptr),
-              color(RED) {}
+        RbNode() noexcept = default;
 
         RbNode(RbNode &&) = delete;
 
         ~RbNode() noexcept {
-            if (tree) {
-                tree->doErase(this);
+            if constexpr (Policy::autoUnlink) {
+                if (tree) {
+                    tree->doErase(this);
+                }
             }
         }
 
         friend struct RbTree;
 
     private:
-        RbNode *left;
-        RbNode *right;
-        RbNode *parent;
-        RbTree *tree;
-        RbColor color;
+        template <int>
+        struct Empty {};
+
+        using ParentField = std::conditional_t<Policy::packColor, std::uintptr_t, RbNode *>;
+        using ColorField = std::conditional_t<Policy::packColor, Empty<0>, RbColor>;
+        using TreeField = std::conditional_t<Policy::autoUnlink, RbTree *, Empty<1>>;
+        using AugmentField = typename std::conditional_t<hasAugment, Augment, std::type_identity<Empty<2>>>::type;
+
+        RbNode *getParent() const noexcept {
+            if constexpr (Policy::packColor) {
+                return reinterpret_cast<RbNode *>(parent & ~std::uintptr_t(1));
+            } else {
+                return parent;
+            }
+        }
+
+        void setParent(RbNode *node) noexcept {
+            if constexpr (Policy::packColor) {
+                parent = reinterpret_cast<std::uintptr_t>(node) | (parent & 1);
+            } else {
+                parent = node;
+            }
+        }
+
+        RbColor getColor() const noexcept {
+            if constexpr (Policy::packColor) {
+                return RbColor(parent & 1);
+            } else {
+                return color;
+            }
+        }
+
+        void setColor(RbColor newColor) noexcept {
+            if constexpr (Policy::packColor) {
+                parent = (parent & ~std::uintptr_t(1)) | std::uintptr_t(newColor);
+            } else {
+                color = newColor;
+            }
+        }
+
+        void setTree(RbTree *newTree) noexcept {
+            if constexpr (Policy::autoUnlink) {
+                tree = newTree;
+            }
+        }
+
+        RbNode *left{nullptr};
+        RbNode *right{nullptr};
+        ParentField parent{};
+        [[no_unique_address]] TreeField tree{};
+        [[no_unique_address]] ColorField color{};
+        [[no_unique_address]] AugmentField augment{};
     };
 
+    using Node = RbNode;
+
+    // 中序双向迭代器，靠 parent 指针移动，不递归也不需要栈；end() 是空节点
+    template <class V>
+    struct Iterator {
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = std::remove_const_t<V>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = V *;
+        using reference = V &;
+
+        Iterator() noexcept : node(nullptr), tree(nullptr) {}
+
+        Iterator(RbNode *node, RbTree const *tree) noexcept
+            : node(node),
+              tree(tree) {}
+
+        operator Iterator<Value const>() const noexcept {
+            return Iterator<Value const>(node, tree);
+        }
+
+        reference operator*() const noexcept {
+            return static_cast<reference>(*node);
+        }
+
+        pointer operator->() const noexcept {
+            return &static_cast<reference>(*node);
+        }
+
+        Iterator &operator++() noexcept {
+            node = RbTree::successor(node);
+            return *this;
+        }
+
+        Iterator operator++(int) noexcept {
+            Iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        Iterator &operator--() noexcept {
+            node = node ? RbTree::predecessor(node) : tree->rightmost;
+            return *this;
+        }
+
+        Iterator operator--(int) noexcept {
+            Iterator old = *this;
+            --*this;
+            return old;
+        }
+
+        friend bool operator==(Iterator const &lhs, Iterator const &rhs) noexcept {
+            return lhs.node == rhs.node;
+        }
+
+    private:
+        RbNode *node;
+        RbTree const *tree;
+
+        friend struct RbTree;
+    };
+
+    using iterator = Iterator<Value>;
+    using const_iterator = Iterator<Value const>;
+
 private:
     RbNode *root;
+    RbNode *leftmost;
+    RbNode *rightmost;
+    std::size_t count;
     Compare comp;
 
+    // 只有 Compare 声明了 is_transparent 时才允许用 Value 以外的类型查找，与 std::set 一致
+    template <class Key>
+    static constexpr bool isLookupKey =
+        std::is_same_v<Key, Value> || requires { typename Compare::is_transparent; };
+
+    static Value const &valueOf(RbNode const *node) noexcept {
+        return static_cast<Value const &>(*node);
+    }
+
     bool compare(RbNode *left, RbNode *right) const noexcept {
         return comp(static_cast<Value &>(*left), static_cast<Value &>(*right));
     }
 
+    static void swapColor(RbNode *lhs, RbNode *rhs) noexcept {
+        RbColor color = lhs->getColor();
+        lhs->setColor(rhs->getColor());
+        rhs->setColor(color);
+    }
+
+    static bool isBlack(RbNode *node) noexcept {
+        return node == nullptr || node->getColor() == BLACK;
+    }
+
+    static RbNode *successor(RbNode *node) noexcept {
+        if (node->right != nullptr) {
+            node = node->right;
+            while (node->left != nullptr) {
+                node = node->left;
+            }
+            return node;
+        }
+        while (node->getParent() != nullptr && node == node->getParent()->right) {
+            node = node->getParent();
+        }
+        return node->getParent();
+    }
+
+    static RbNode *predecessor(RbNode *node) noexcept {
+        if (node->left != nullptr) {
+            node = node->left;
+            while (node->right != nullptr) {
+                node = node->right;
+            }
+            return node;
+        }
+        while (node->getParent() != nullptr && node == node->getParent()->left) {
+            node = node->getParent();
+        }
+        return node->getParent();
+    }
+
+    // 用孩子的聚合值重新计算 node 的聚合值
+    void refresh(RbNode *node) const noexcept {
+        if constexpr (hasAugment) {
+            Augment::update(node->augment, valueOf(node),
+                            node->left ? &node->left->augment : nullptr,
+                            node->right ? &node->right->augment : nullptr);
+        }
+    }
+
+    // 从 node 一直更新到根，用于结构变化之后、修复之前
+    void refreshUp(RbNode *node) const noexcept {
+        if constexpr (hasAugment) {
+            for (; node != nullptr; node = node->getParent()) {
+                refresh(node);
+            }
+        }
+    }
+
+    // 旋转只改变这两个节点的子树，其他节点的聚合值不变
     void rotateLeft(RbNode *node) noexcept {
         RbNode *rightChild = node->right;
         node->right = rightChild->left;
         if (rightChild->left != nullptr) {
-            rightChild->left->parent = node;
+            rightChild->left->setParent(node);
         }
-        rightChild->parent = node->parent;
-        if (node->parent == nullptr) {
+        rightChild->setParent(node->getParent());
+        if (node->getParent() == nullptr) {
             root = rightChild;
-        } else if (node == node->parent->left) {
-            node->parent->left = rightChild;
+        } else if (node == node->getParent()->left) {
+            node->getParent()->left = rightChild;
         } else {
-            node->parent->right = rightChild;
+            node->getParent()->right = rightChild;
         }
         rightChild->left = node;
-        node->parent = rightChild;
+        node->setParent(rightChild);
+        refresh(node);
+        refresh(rightChild);
     }
 
     void rotateRight(RbNode *node) noexcept {
         RbNode *leftChild = node->left;
         node->left = leftChild->right;
         if (leftChild->right != nullptr) {
-            leftChild->right->parent = node;
+            leftChild->right->setParent(node);
         }
-        leftChild->parent = node->parent;
-        if (node->parent == nullptr) {
+        leftChild->setParent(node->getParent());
+        if (node->getParent() == nullptr) {
             root = leftChild;
-        } else if (node == node->parent->right) {
-            node->parent->right = leftChild;
+        } else if (node == node->getParent()->right) {
+            node->getParent()->right = leftChild;
         } else {
-            node->parent->left = leftChild;
+            node->getParent()->left = leftChild;
         }
         leftChild->right = node;
-        node->parent = leftChild;
+        node->setParent(leftChild);
+        refresh(node);
+        refresh(leftChild);
     }
 
     void fixViolation(RbNode *node) noexcept {
         RbNode *parent = nullptr;
         RbNode *grandParent = nullptr;
 
-        while (node != root && node->color != BLACK &&
-               node->parent->color == RED) {
-            parent = node->parent;
-            grandParent = parent->parent;
+        while (node != root && node->getColor() != BLACK &&
+               node->getParent()->getColor() == RED) {
+            parent = node->getParent();
+            grandParent = parent->getParent();
 
             if (parent == grandParent->left) {
                 RbNode *uncle = grandParent->right;
 
-                if (uncle != nullptr && uncle->color == RED) {
-                    grandParent->color = RED;
-                    parent->color = BLACK;
-                    uncle->color = BLACK;
+                if (uncle != nullptr && uncle->getColor() == RED) {
+                    grandParent->setColor(RED);
+                    parent->setColor(BLACK);
+                    uncle->setColor(BLACK);
                     node = grandParent;
                 } else {
                     if (node == parent->right) {
                         rotateLeft(parent);
                         node = parent;
-                        parent = node->parent;
+                        parent = node->getParent();
                     }
                     rotateRight(grandParent);
-                    std::swap(parent->color, grandParent->color);
+                    swapColor(parent, grandParent);
                     node = parent;
                 }
             } else {
                 RbNode *uncle = grandParent->left;
 
-                if (uncle != nullptr && uncle->color == RED) {
-                    grandParent->color = RED;
-                    parent->color = BLACK;
-                    uncle->color = BLACK;
+                if (uncle != nullptr && uncle->getColor() == RED) {
+                    grandParent->setColor(RED);
+                    parent->setColor(BLACK);
+                    uncle->setColor(BLACK);
                     node = grandParent;
                 } else {
                     if (node == parent->left) {
                         rotateRight(parent);
                         node = parent;
-                        parent = node->parent;
+                        parent = node->getParent();
                     }
                     rotateLeft(grandParent);
-                    std::swap(parent->color, grandParent->color);
+                    swapColor(parent, grandParent);
                     node = parent;
                 }
             }
         }
 
-        root->color = BLACK;
+        root->setColor(BLACK);
     }
 
     void doInsert(RbNode *node) noexcept {
         node->left = nullptr;
         node->right = nullptr;
-        node->tree = this;
-        node->color = RED;
+        node->setTree(this);
+        node->setColor(RED);
 
         RbNode *parent = nullptr;
         RbNode *current = root;
+        bool isLeftmost = true;
+        bool isRightmost = true;
 
         while (current != nullptr) {
             parent = current;
             if (compare(node, current)) {
                 current = current->left;
+                isRightmost = false;
             } else {
                 current = current->right;
+                isLeftmost = false;
             }
         }
 
-        node->parent = parent;
+        node->setParent(parent);
         if (parent == nullptr) {
             root = node;
         } else if (compare(node, parent)) {
@@ -158,156 +409,467 @@ private:
             parent->right = node;
         }
 
+        if (isLeftmost) {
+            leftmost = node;
+        }
+        if (isRightmost) {
+            rightmost = node;
+        }
+        ++count;
+
+        refreshUp(node);
         fixViolation(node);
     }
 
-    /* template <class Key> */
-    /* RbNode* doFind(Key &&key) const { */
-    /*     RbNode* current = root; */
-    /*     // Find the node to delete */
-    /*     while (current != nullptr) { */
-    /*         if (key_compare(key, current)) { */
-    /*             current = current->left; */
-    /*         } else { */
-    /*             current = current->right; */
-    /*         } */
-    /*     } */
-    /*     return nullptr; */
-    /* } */
-
-    /* void doErase(RbNode* node) noexcept { */
-    /*     RbNode* parent = nullptr; */
-    /*  */
-    /*     // Case 1: Node to delete has no children */
-    /*     if (node->left == nullptr && node->right == nullptr) { */
-    /*         if (node == root) { */
-    /*             root = nullptr; */
-    /*         } else { */
-    /*             if (node == parent->left) { */
-    /*                 parent->left = nullptr; */
-    /*             } else { */
-    /*                 parent->right = nullptr; */
-    /*             } */
-    /*         } */
-    /*         delete node; */
-    /*     } */
-    /*     // Case 2: Node to delete has one child */
-    /*     else if (node->left == nullptr || node->right == nullptr) { */
-    /*         RbNode* child = (node->left != nullptr) ? node->left : node->right; */
-    /*  */
-    /*         if (node == root) { */
-    /*             root = child; */
-    /*         } else { */
-    /*             if (node == parent->left) { */
-    /*                 parent->left = child; */
-    /*             } else { */
-    /*                 parent->right = child; */
-    /*             } */
-    /*         } */
-    /*         child->parent = parent; */
-    /*         delete node; */
-    /*     } */
-    /*     // Case 3: Node to delete has two children */
-    /*     else { */
-    /*         RbNode* successor = node->right; */
-    /*         while (successor->left != nullptr) { */
-    /*             successor = successor->left; */
-    /*         } */
-    /*         doErase(successor); */
-    /*     } */
-    /* } */
+    // 用 replace 替换 node 在父节点中的位置
+    void transplant(RbNode *node, RbNode *replace) noexcept {
+        if (node->getParent() == nullptr) {
+            root = replace;
+        } else if (node == node->getParent()->left) {
+            node->getParent()->left = replace;
+        } else {
+            node->getParent()->right = replace;
+        }
+        if (replace != nullptr) {
+            replace->setParent(node->getParent());
+        }
+    }
 
     void doErase(RbNode *current) noexcept {
-        current->tree = nullptr;
+        current->setTree(nullptr);
+        if (current == leftmost) {
+            leftmost = successor(current);
+        }
+        if (current == rightmost) {
+            rightmost = predecessor(current);
+        }
+        --count;
 
-        RbNode *node = nullptr;
+        // child 顶替被摘走的位置，可能为空，所以单独记下它的父节点
         RbNode *child = nullptr;
-        RbColor color = RED;
+        RbNode *parent = nullptr;
+        RbColor color = current->getColor();
 
-        if (current->left != nullptr && current->right != nullptr) {
-            RbNode *replace = current;
-            replace = replace->right;
+        if (current->left == nullptr || current->right == nullptr) {
+            child = (current->left != nullptr) ? current->left : current->right;
+            parent = current->getParent();
+            transplant(current, child);
+        } else {
+            RbNode *replace = current->right;
             while (replace->left != nullptr) {
                 replace = replace->left;
             }
+            color = replace->getColor();
+            child = replace->right;
 
-            if (current != replace->parent) {
-                current->parent->left = replace->right;
+            if (replace->getParent() == current) {
+                parent = replace;
+            } else {
+                parent = replace->getParent();
+                transplant(replace, replace->right);
                 replace->right = current->right;
-                current->right->parent = replace;
+                replace->right->setParent(replace);
+            }
+
+            transplant(current, replace);
+            replace->left = current->left;
+            replace->left->setParent(replace);
+            replace->setColor(current->getColor());
+        }
+
+        refreshUp(parent);
+        if (color == BLACK) {
+            fixErase(child, parent);
+        }
+    }
+
+    // 删掉黑色节点后 child 所在的路径少了一个黑节点，沿途旋转、染色补回来
+    void fixErase(RbNode *child, RbNode *parent) noexcept {
+        while (child != root && isBlack(child)) {
+            if (child == parent->left) {
+                RbNode *sibling = parent->right;
+                if (sibling->getColor() == RED) {
+                    sibling->setColor(BLACK);
+                    parent->setColor(RED);
+                    rotateLeft(parent);
+                    sibling = parent->right;
+                }
+                if (isBlack(sibling->left) && isBlack(sibling->right)) {
+                    sibling->setColor(RED);
+                    child = parent;
+                    parent = child->getParent();
+                } else {
+                    if (isBlack(sibling->right)) {
+                        sibling->left->setColor(BLACK);
+                        sibling->setColor(RED);
+                        rotateRight(sibling);
+                        sibling = parent->right;
+                    }
+                    sibling->setColor(parent->getColor());
+                    parent->setColor(BLACK);
+                    sibling->right->setColor(BLACK);
+                    rotateLeft(parent);
+                    child = root;
+                }
             } else {
-                replace->parent = current;
+                RbNode *sibling = parent->left;
+                if (sibling->getColor() == RED) {
+                    sibling->setColor(BLACK);
+                    parent->setColor(RED);
+                    rotateRight(parent);
+                    sibling = parent->left;
+                }
+                if (isBlack(sibling->left) && isBlack(sibling->right)) {
+                    sibling->setColor(RED);
+                    child = parent;
+                    parent = child->getParent();
+                } else {
+                    if (isBlack(sibling->left)) {
+                        sibling->right->setColor(BLACK);
+                        sibling->setColor(RED);
+                        rotateLeft(sibling);
+                        sibling = parent->left;
+                    }
+                    sibling->setColor(parent->getColor());
+                    parent->setColor(BLACK);
+                    sibling->left->setColor(BLACK);
+                    rotateRight(parent);
+                    child = root;
+                }
             }
+        }
+
+        if (child != nullptr) {
+            child->setColor(BLACK);
+        }
+    }
 
-            if (current == root) {
-                root = replace;
-            } else if (current->parent->left == current) {
-                current->parent->left = replace;
+    // 第一个不小于 key 的节点
+    template <class Key>
+    RbNode *doLowerBound(Key const &key) const {
+        RbNode *result = nullptr;
+        RbNode *current = root;
+        while (current != nullptr) {
+            if (!comp(valueOf(current), key)) {
+                result = current;
+                current = current->left;
             } else {
-                current->parent->right = replace;
+                current = current->right;
             }
+        }
+        return result;
+    }
 
-            replace->left = current->left;
-            current->left->parent = replace;
+    // 第一个大于 key 的节点
+    template <class Key>
+    RbNode *doUpperBound(Key const &key) const {
+        RbNode *result = nullptr;
+        RbNode *current = root;
+        while (current != nullptr) {
+            if (comp(key, valueOf(current))) {
+                result = current;
+                current = current->left;
+            } else {
+                current = current->right;
+            }
+        }
+        return result;
+    }
 
-            node = replace;
-            color = node->color;
-            child = node->right;
-        } else {
-            node = current;
-            color = node->color;
-            child = (node->left != nullptr) ? node->left : node->right;
+    template <class Key>
+    RbNode *doFind(Key const &key) const {
+        RbNode *node = doLowerBound(key);
+        if (node != nullptr && !comp(key, valueOf(node))) {
+            return node;
         }
+        return nullptr;
+    }
 
-        if (child != nullptr) {
-            child->parent = node->parent;
+    static RbNode *minimum(RbNode *node) noexcept {
+        if (node != nullptr) {
+            while (node->left != nullptr) {
+                node = node->left;
+            }
         }
+        return node;
+    }
 
-        if (node == root) {
-            root = child;
-        } else if (node->parent->left == node) {
-            node->parent->left = child;
-        } else {
-            node->parent->right = child;
+    static RbNode *maximum(RbNode *node) noexcept {
+        if (node != nullptr) {
+            while (node->right != nullptr) {
+                node = node->right;
+            }
         }
+        return node;
+    }
 
-        if (color == BLACK && root) {
-            fixViolation(child ? child : node->parent);
+    // 以下是批量操作的辅助函数，其中有序链表都借用 right 指针串起来
+
+    static int blackHeight(RbNode *node) noexcept {
+        int height = 0;
+        for (; node != nullptr; node = node->left) {
+            if (node->getColor() == BLACK) {
+                ++height;
+            }
         }
+        return height;
     }
 
-    RbNode *getFront() const noexcept {
-        RbNode *current = root;
-        while (current->left != nullptr) {
-            current = current->left;
+    // 把子树从父节点上断开、根染黑，作为一棵独立的树参与 join
+    static RbNode *detach(RbNode *node) noexcept {
+        if (node != nullptr) {
+            node->setParent(nullptr);
+            node->setColor(BLACK);
         }
-        return current;
+        return node;
     }
 
-    RbNode *getBack() const noexcept {
-        RbNode *current = root;
-        while (current->right != nullptr) {
-            current = current->right;
+    // left 中的元素都不大于 pivot，right 中的都不小于 pivot，两棵树的根都是黑色
+    // 沿较高那棵树的边走到黑高相同的位置挂上红色的 pivot，再按插入修复红色冲突
+    // 修复时借用 root 作为当前的根，返回合并后的根
+    RbNode *doJoin(RbNode *left, RbNode *pivot, RbNode *right) noexcept {
+        int leftHeight = blackHeight(left);
+        int rightHeight = blackHeight(right);
+        RbNode *parent = nullptr;
+
+        if (leftHeight == rightHeight) {
+            pivot->left = left;
+            pivot->right = right;
+            pivot->setColor(BLACK);
+        } else if (leftHeight > rightHeight) {
+            RbNode *current = left;
+            int height = leftHeight;
+            while (!isBlack(current) || height != rightHeight) {
+                if (isBlack(current)) {
+                    --height;
+                }
+                parent = current;
+                current = current->right;
+            }
+            pivot->left = current;
+            pivot->right = right;
+            parent->right = pivot;
+            pivot->setColor(RED);
+            root = left;
+        } else {
+            RbNode *current = right;
+            int height = rightHeight;
+            while (!isBlack(current) || height != leftHeight) {
+                if (isBlack(current)) {
+                    --height;
+                }
+                parent = current;
+                current = current->left;
+            }
+            pivot->left = left;
+            pivot->right = current;
+            parent->left = pivot;
+            pivot->setColor(RED);
+            root = right;
         }
-        return current;
+
+        pivot->setParent(parent);
+        if (pivot->left != nullptr) {
+            pivot->left->setParent(pivot);
+        }
+        if (pivot->right != nullptr) {
+            pivot->right->setParent(pivot);
+        }
+        refreshUp(pivot);
+        if (parent == nullptr) {
+            return pivot;
+        }
+        fixViolation(pivot);
+        return root;
     }
 
-    template <class Visitor>
-    void doTraversalInorder(RbNode *node, Visitor &&visitor) {
+    // 沿查找路径把树拆成不大于 key 和大于 key 的两部分，路径上的节点作为 pivot 依次 join
+    // 递归深度不超过树高
+    template <class Key>
+    std::pair<RbNode *, RbNode *> doSplit(RbNode *node, Key const &key) noexcept {
         if (node == nullptr) {
+            return {nullptr, nullptr};
+        }
+        RbNode *left = detach(node->left);
+        RbNode *right = detach(node->right);
+        if (comp(key, valueOf(node))) {
+            auto [lower, upper] = doSplit(left, key);
+            return {lower, doJoin(upper, node, right)};
+        }
+        auto [lower, upper] = doSplit(right, key);
+        return {doJoin(left, node, lower), upper};
+    }
+
+    // 按中序把整棵树串成链表；从最大的往前取，只改 right，不影响后续的 predecessor
+    RbNode *flatten() noexcept {
+        RbNode *head = nullptr;
+        for (RbNode *node = rightmost; node != nullptr;) {
+            RbNode *prev = predecessor(node);
+            node->right = head;
+            head = node;
+            node = prev;
+        }
+        return head;
+    }
+
+    // 合并两条有序链表；相等时 first 的在前，与逐个 insert 的顺序一致
+    RbNode *mergeLists(RbNode *first, RbNode *second) const noexcept {
+        RbNode *head = nullptr;
+        RbNode **tail = &head;
+        while (first != nullptr && second != nullptr) {
+            if (compare(second, first)) {
+                *tail = second;
+                second = second->right;
+            } else {
+                *tail = first;
+                first = first->right;
+            }
+            tail = &(*tail)->right;
+        }
+        *tail = first != nullptr ? first : second;
+        return head;
+    }
+
+    // 从有序链表的前 n 个节点建一棵平衡树：中间的做根，叶子只在最后两层，
+    // 最深一层染红、其余染黑，每条路径的黑节点数就都相同
+    RbNode *doBuild(RbNode *&head, std::size_t n, int depth, int redDepth) noexcept {
+        if (n == 0) {
+            return nullptr;
+        }
+        std::size_t leftCount = (n - 1) / 2;
+        RbNode *left = doBuild(head, leftCount, depth + 1, redDepth);
+        RbNode *node = head;
+        head = head->right;
+        node->left = left;
+        if (left != nullptr) {
+            left->setParent(node);
+        }
+        node->right = doBuild(head, n - 1 - leftCount, depth + 1, redDepth);
+        if (node->right != nullptr) {
+            node->right->setParent(node);
+        }
+        node->setTree(this);
+        node->setColor(depth == redDepth ? RED : BLACK);
+        refresh(node);
+        return node;
+    }
+
+    void rebuild(RbNode *head, std::size_t n) noexcept {
+        root = doBuild(head, n, 0, int(std::bit_width(n)) - 1);
+        if (root != nullptr) {
+            root->setParent(nullptr);
+            root->setColor(BLACK);
+        }
+        leftmost = minimum(root);
+        rightmost = maximum(root);
+        count = n;
+    }
+
+    // 并入一条 m 个新节点的有序链表：新节点少时逐个插入 O(m log n)，否则整体重建 O(n + m)
+    void doMergeList(RbNode *head, std::size_t m) noexcept {
+        if (m == 0) {
             return;
         }
+        if (m * std::size_t(std::bit_width(count + m)) < count + m) {
+            while (head != nullptr) {
+                RbNode *next = head->right;
+                doInsert(head);
+                head = next;
+            }
+            return;
+        }
+        rebuild(mergeLists(flatten(), head), count + m);
+    }
+
+    void retarget(RbTree *tree) noexcept {
+        if constexpr (Policy::autoUnlink) {
+            for (RbNode *node = leftmost; node != nullptr; node = successor(node)) {
+                node->setTree(tree);
+            }
+        }
+    }
+
+    void reset() noexcept {
+        root = nullptr;
+        leftmost = nullptr;
+        rightmost = nullptr;
+        count = 0;
+    }
+
+    static std::size_t subtreeSize(RbNode const *node) noexcept {
+        return node ? node->augment : 0;
+    }
+
+    RbNode *doSelect(std::size_t index) const noexcept {
+        RbNode *node = root;
+        while (node != nullptr) {
+            std::size_t leftSize = subtreeSize(node->left);
+            if (index < leftSize) {
+                node = node->left;
+            } else if (index == leftSize) {
+                return node;
+            } else {
+                index -= leftSize + 1;
+                node = node->right;
+            }
+        }
+        return nullptr;
+    }
+
+    // 左子树的最大右端点不小于 low 时，若左边没有重叠的区间，右边也不会有
+    template <class T>
+    RbNode *doFindOverlap(T const &low, T const &high) const {
+        RbNode *node = root;
+        while (node != nullptr) {
+            if (!(high < valueOf(node).low()) && !(valueOf(node).high() < low)) {
+                return node;
+            }
+            if (node->left != nullptr && !(node->left->augment < low)) {
+                node = node->left;
+            } else {
+                node = node->right;
+            }
+        }
+        return nullptr;
+    }
+
+    // 递归深度不超过树高；右端点最大值小于 low 的子树、左端点大于 high 的节点及其右子树都被剪掉
+    template <class T, class Visitor>
+    void doForEachOverlap(RbNode *node, T const &low, T const &high, Visitor &visitor) {
+        if (node == nullptr || node->augment < low) {
+            return;
+        }
+        doForEachOverlap(node->left, low, high, visitor);
+        if (high < valueOf(node).low()) {
+            return;
+        }
+        if (!(valueOf(node).high() < low)) {
+            visitor(static_cast<Value &>(*node));
+        }
+        doForEachOverlap(node->right, low, high, visitor);
+    }
 
-        traversalInorder(node->left, visitor);
-        visitor(node);
-        doTraversalInorder(node->right, visitor);
+    template <class Visitor>
+    void doTraversalInorder(Visitor &&visitor) {
+        for (RbNode *node = leftmost; node != nullptr;) {
+            RbNode *next = successor(node); // visitor 可能把 node 从树里删掉
+            visitor(node);
+            node = next;
+        }
     }
 
 public:
-    RbTree() noexcept : root(nullptr) {}
+    RbTree() noexcept
+        : root(nullptr),
+          leftmost(nullptr),
+          rightmost(nullptr),
+          count(0) {}
 
     explicit RbTree(Compare comp) noexcept(noexcept(Compare(comp)))
         : root(nullptr),
+          leftmost(nullptr),
+          rightmost(nullptr),
+          count(0),
           comp(comp) {}
 
     RbTree(RbTree &&) = delete;
@@ -322,20 +884,269 @@ public:
         doErase(&static_cast<RbNode &>(value));
     }
 
+    iterator erase(const_iterator pos) noexcept {
+        RbNode *next = successor(pos.node);
+        doErase(pos.node);
+        return iterator(next, this);
+    }
+
     bool empty() const noexcept {
         return root == nullptr;
     }
 
+    std::size_t size() const noexcept {
+        return count;
+    }
+
     Value &front() const noexcept {
-        return static_cast<Value &>(*getFront());
+        return static_cast<Value &>(*leftmost);
     }
 
     Value &back() const noexcept {
-        return static_cast<Value &>(*getBack());
+        return static_cast<Value &>(*rightmost);
+    }
+
+    iterator begin() noexcept {
+        return iterator(leftmost, this);
+    }
+
+    const_iterator begin() const noexcept {
+        return const_iterator(leftmost, this);
+    }
+
+    iterator end() noexcept {
+        return iterator(nullptr, this);
+    }
+
+    const_iterator end() const noexcept {
+        return const_iterator(nullptr, this);
+    }
+
+    // value 必须已经在这棵树里
+    iterator iteratorTo(Value &value) noexcept {
+        return iterator(&static_cast<RbNode &>(value), this);
+    }
+
+    template <class Key> requires isLookupKey<Key>
+    iterator find(Key const &key) {
+        return iterator(doFind(key), this);
+    }
+
+    template <class Key> requires isLookupKey<Key>
+    const_iterator find(Key const &key) const {
+        return const_iterator(doFind(key), this);
+    }
+
+    template <class Key> requires isLookupKey<Key>
+    iterator lower_bound(Key const &key) {
+        return iterator(doLowerBound(key), this);
+    }
+
+    template <class Key> requires isLookupKey<Key>
+    const_iterator lower_bound(Key const &key) const {
+        return const_iterator(doLowerBound(key), this);
+    }
+
+    template <class Key> requires isLookupKey<Key>
+    iterator upper_bound(Key const &key) {
+        return iterator(doUpperBound(key), this);
+    }
+
+    template <class Key> requires isLookupKey<Key>
+    const_iterator upper_bound(Key const &key) const {
+        return const_iterator(doUpperBound(key), this);
+    }
+
+    // 批量插入一个按 Compare 升序排好的区间，区间里的元素不能已经在某棵树里
+    // 空树上 O(n) 直接建出平衡树，不做任何旋转
+    template <std::ranges::input_range R>
+    void insertSorted(R &&range) noexcept {
+        RbNode *head = nullptr;
+        RbNode **tail = &head;
+        std::size_t m = 0;
+        for (Value &value: range) {
+            RbNode *node = &static_cast<RbNode &>(value);
+            *tail = node;
+            tail = &node->right;
+            ++m;
+        }
+        *tail = nullptr;
+        doMergeList(head, m);
+    }
+
+    // 把 that 的元素整体接到本树之后，要求 that 中的元素都不小于本树中的元素
+    // O(log n)，AutoUnlink 策略下另外要改写 that 中每个节点的 tree 指针
+    void join(RbTree &that) noexcept {
+        if (that.root == nullptr) {
+            return;
+        }
+        RbNode *pivot = that.leftmost;
+        that.doErase(pivot);
+        that.retarget(this);
+        RbNode *newLeftmost = root != nullptr ? leftmost : pivot;
+        RbNode *newRightmost = that.root != nullptr ? that.rightmost : pivot;
+        std::size_t newCount = count + that.count + 1;
+        root = doJoin(root, pivot, that.root);
+        pivot->setTree(this);
+        leftmost = newLeftmost;
+        rightmost = newRightmost;
+        count = newCount;
+        that.reset();
+    }
+
+    // 把所有不大于 key 的元素移到 lower（必须为空），本树只留下大于 key 的元素
+    // 拆分本身 O(log² n)，另外要遍历移走的部分来计数和改写 tree 指针
+    template <class Key> requires isLookupKey<Key>
+    void split(Key const &key, RbTree &lower) noexcept {
+        if (root == nullptr) {
+            return;
+        }
+        auto [lowerRoot, upperRoot] = doSplit(detach(root), key);
+        lower.root = lowerRoot;
+        lower.leftmost = minimum(lowerRoot);
+        lower.rightmost = maximum(lowerRoot);
+        lower.count = 0;
+        for (RbNode *node = lower.leftmost; node != nullptr; node = successor(node)) {
+            node->setTree(&lower);
+            ++lower.count;
+        }
+        root = upperRoot;
+        leftmost = minimum(upperRoot);
+        rightmost = upperRoot != nullptr ? rightmost : nullptr;
+        count -= lower.count;
+    }
+
+    // 把 that 的元素全部并入本树，that 变为空：
+    // 值域不重叠时走 join，否则按有序链表归并，相等的元素本树的在前
+    void merge(RbTree &that) noexcept {
+        if (that.root == nullptr) {
+            return;
+        }
+        if (root == nullptr || !compare(that.leftmost, rightmost)) {
+            join(that);
+            return;
+        }
+        if (compare(that.rightmost, leftmost)) {
+            RbNode *pivot = that.rightmost;
+            that.doErase(pivot);
+            that.retarget(this);
+            RbNode *newLeftmost = that.root != nullptr ? that.leftmost : pivot;
+            std::size_t newCount = count + that.count + 1;
+            root = doJoin(that.root, pivot, root);
+            pivot->setTree(this);
+            leftmost = newLeftmost;
+            count = newCount;
+            that.reset();
+            return;
+        }
+        std::size_t m = that.count;
+        RbNode *head = that.flatten();
+        that.reset();
+        doMergeList(head, m);
+    }
+
+    // value 所在子树的聚合值，value 必须在这棵树里
+    static auto const &augmentOf(Value const &value) noexcept
+        requires hasAugment {
+        return static_cast<RbNode const &>(value).augment;
+    }
+
+    // value 前面有多少个元素，value 必须在这棵树里，O(log n)
+    std::size_t rank(Value const &value) const noexcept
+        requires std::is_same_v<Augment, RbSubtreeSize> {
+        RbNode const *node = &static_cast<RbNode const &>(value);
+        std::size_t result = subtreeSize(node->left);
+        for (; node->getParent() != nullptr; node = node->getParent()) {
+            if (node == node->getParent()->right) {
+                result += subtreeSize(node->getParent()->left) + 1;
+            }
+        }
+        return result;
+    }
+
+    // 第 index 个元素（从 0 开始），越界时返回 end()，O(log n)
+    iterator select(std::size_t index) noexcept
+        requires std::is_same_v<Augment, RbSubtreeSize> {
+        return iterator(doSelect(index), this);
+    }
+
+    const_iterator select(std::size_t index) const noexcept
+        requires std::is_same_v<Augment, RbSubtreeSize> {
+        return const_iterator(doSelect(index), this);
+    }
+
+    // 任意一个与闭区间 [low, high] 重叠的元素，没有时返回 end()，O(log n)
+    template <class T>
+    iterator findOverlap(T const &low, T const &high)
+        requires isRbMaxEnd<Augment> {
+        return iterator(doFindOverlap(low, high), this);
+    }
+
+    // 按 low() 升序访问所有与闭区间 [low, high] 重叠的元素，visitor 里不能修改这棵树
+    template <class T, class Visitor>
+    void forEachOverlap(T const &low, T const &high, Visitor &&visitor)
+        requires isRbMaxEnd<Augment> {
+        doForEachOverlap(root, low, high, visitor);
+    }
+
+    // 检查红黑性质、父指针、有序性、聚合值以及缓存的 leftmost/rightmost/count，供测试使用，O(n log n)
+    bool validate() const noexcept {
+        if (root == nullptr) {
+            return leftmost == nullptr && rightmost == nullptr && count == 0;
+        }
+        if (root->getParent() != nullptr || root->getColor() != BLACK) {
+            return false;
+        }
+        if (leftmost != minimum(root) || rightmost != maximum(root)) {
+            return false;
+        }
+        int expectedHeight = -1;
+        std::size_t visited = 0;
+        for (RbNode *node = leftmost; node != nullptr; node = successor(node)) {
+            ++visited;
+            if constexpr (Policy::autoUnlink) {
+                if (node->tree != this) {
+                    return false;
+                }
+            }
+            for (RbNode *child: {node->left, node->right}) {
+                if (child != nullptr && child->getParent() != node) {
+                    return false;
+                }
+                if (child != nullptr && node->getColor() == RED && child->getColor() == RED) {
+                    return false;
+                }
+            }
+            RbNode *next = successor(node);
+            if (next != nullptr && compare(next, node)) {
+                return false;
+            }
+            if constexpr (hasAugment) {
+                typename Augment::type expected{};
+                Augment::update(expected, valueOf(node),
+                                node->left ? &node->left->augment : nullptr,
+                                node->right ? &node->right->augment : nullptr);
+                if (!(expected == node->augment)) {
+                    return false;
+                }
+            }
+            if (node->left == nullptr || node->right == nullptr) {
+                int height = 0;
+                for (RbNode *up = node; up != nullptr; up = up->getParent()) {
+                    height += up->getColor() == BLACK;
+                }
+                if (expectedHeight == -1) {
+                    expectedHeight = height;
+                } else if (height != expectedHeight) {
+                    return false;
+                }
+            }
+        }
+        return visited == count;
     }
 
     template <class Visitor>
     void traversalInorder(Visitor &&visitor) {
-        doTraversalInorder(root, std::forward<Visitor>(visitor));
+        doTraversalInorder(std::forward<Visitor>(visitor));
     }
-};
\ No newline at end of file
+};
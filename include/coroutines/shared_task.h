@@ -0,0 +1,195 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <type_traits>
+#include <utility>
+#include "coro.h"
+
+// 挂在 SharedPromise 上的等待者，节点就是 co_await 表达式里的 Awaiter 本身，不需要额外分配
+struct SharedWaiter {
+    SharedWaiter *mNext{};
+    std::coroutine_handle<> mCoroutine{};
+};
+
+struct SharedFinalAwaiter {
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    // 第一个等待者直接对称转移过去，其余的按等待顺序放进 Loop 的就绪队列
+    template<class P>
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<P> coroutine) const noexcept {
+        auto &promise = coroutine.promise();
+        promise.mDone = true;
+        SharedWaiter *waiter = std::exchange(promise.mWaitHead, nullptr);
+        promise.mWaitTail = nullptr;
+        if (!waiter)
+            return std::noop_coroutine();
+        auto first = waiter->mCoroutine;
+        for (waiter = waiter->mNext; waiter; waiter = waiter->mNext)
+            getLoop().addTask(waiter->mCoroutine);
+        return first;
+    }
+
+    void await_resume() const noexcept {
+    }
+};
+
+struct SharedPromiseBase : FrameProfileHook {
+    SharedPromiseBase(std::source_location loc) noexcept
+        : FrameProfileHook(loc) {
+    }
+
+    auto initial_suspend() noexcept {
+        return std::suspend_always();
+    }
+
+    auto final_suspend() noexcept {
+        return SharedFinalAwaiter();
+    }
+
+    void unhandled_exception() noexcept {
+        mException = std::current_exception();
+    }
+
+    void pushWaiter(SharedWaiter *waiter) noexcept {
+        if (mWaitTail)
+            mWaitTail->mNext = waiter;
+        else
+            mWaitHead = waiter;
+        mWaitTail = waiter;
+    }
+
+    SharedWaiter *mWaitHead{};
+    SharedWaiter *mWaitTail{};
+    std::size_t mRefCount{1};
+    bool mStarted{false};
+    bool mDone{false};
+    std::exception_ptr mException{};
+
+    SharedPromiseBase &operator=(SharedPromiseBase &&) = delete;
+};
+
+template<class T>
+struct SharedPromise : SharedPromiseBase {
+    SharedPromise(std::source_location loc = std::source_location::current()) noexcept
+        : SharedPromiseBase(loc) {
+    }
+
+    void return_value(T &&ret) {
+        mResult.putValue(std::move(ret));
+        mHasValue = true;
+    }
+
+    void return_value(T const &ret) {
+        mResult.putValue(ret);
+        mHasValue = true;
+    }
+
+    T const &result() const {
+        if (mException) [[unlikely]] {
+            std::rethrow_exception(mException);
+        }
+        return mResult.mValue;
+    }
+
+    auto get_return_object() {
+        return std::coroutine_handle<SharedPromise>::from_promise(*this);
+    }
+
+    ~SharedPromise() {
+        if (mHasValue)
+            mResult.mValue.~T();
+    }
+
+    Uninitialized<T> mResult;
+    bool mHasValue{false};
+};
+
+template<>
+struct SharedPromise<void> : SharedPromiseBase {
+    SharedPromise(std::source_location loc = std::source_location::current()) noexcept
+        : SharedPromiseBase(loc) {
+    }
+
+    void return_void() noexcept {
+    }
+
+    void result() const {
+        if (mException) [[unlikely]] {
+            std::rethrow_exception(mException);
+        }
+    }
+
+    auto get_return_object() {
+        return std::coroutine_handle<SharedPromise>::from_promise(*this);
+    }
+};
+
+// 只运行一次、可以被任意多个协程 co_await 的任务，结果以 const 引用共享
+// 第一次被 co_await 时才开始运行，拷贝 SharedTask 只增加引用计数
+template<class T = void>
+struct SharedTask {
+    using promise_type = SharedPromise<T>;
+
+    SharedTask(std::coroutine_handle<promise_type> coroutine) noexcept
+        : mCoroutine(coroutine) {
+    }
+
+    SharedTask(SharedTask const &that) noexcept
+        : mCoroutine(that.mCoroutine) {
+        if (mCoroutine)
+            ++mCoroutine.promise().mRefCount;
+    }
+
+    SharedTask(SharedTask &&that) noexcept
+        : mCoroutine(std::exchange(that.mCoroutine, nullptr)) {
+    }
+
+    SharedTask &operator=(SharedTask that) noexcept {
+        std::swap(mCoroutine, that.mCoroutine);
+        return *this;
+    }
+
+    ~SharedTask() {
+        if (mCoroutine && --mCoroutine.promise().mRefCount == 0)
+            mCoroutine.destroy();
+    }
+
+    struct Awaiter : SharedWaiter {
+        bool await_ready() const noexcept {
+            return mTask.mCoroutine.promise().mDone;
+        }
+
+        std::coroutine_handle<>
+        await_suspend(std::coroutine_handle<> coroutine) noexcept {
+            auto &promise = mTask.mCoroutine.promise();
+            mCoroutine = coroutine;
+            promise.pushWaiter(this);
+            if (!promise.mStarted) {
+                promise.mStarted = true;
+                return mTask.mCoroutine;
+            }
+            return std::noop_coroutine();
+        }
+
+        // 返回的引用在最后一个 SharedTask 析构前一直有效
+        decltype(auto) await_resume() const {
+            return mTask.mCoroutine.promise().result();
+        }
+
+        SharedTask mTask; // 等待期间持有一份引用，防止任务在恢复等待者之前被销毁
+    };
+
+    Awaiter operator co_await() const noexcept {
+        return Awaiter{{}, *this};
+    }
+
+    bool done() const noexcept {
+        return mCoroutine.promise().mDone;
+    }
+
+    std::coroutine_handle<promise_type> mCoroutine;
+};
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "coro.h"
+
+// 每个工作线程有自己的任务队列：从工作线程里提交的任务进自己的队列（后进先出，缓存友好），
+// 外部线程提交的任务轮流分给各个队列；自己的队列空了就从别人队列的另一头偷
+struct ThreadPool {
+    explicit ThreadPool(std::size_t numWorkers = std::thread::hardware_concurrency()) {
+        if (numWorkers == 0)
+            numWorkers = 1;
+        mQueues.reserve(numWorkers);
+        for (std::size_t i = 0; i < numWorkers; ++i)
+            mQueues.push_back(std::make_unique<WorkQueue>());
+        mWorkers.reserve(numWorkers);
+        for (std::size_t i = 0; i < numWorkers; ++i)
+            mWorkers.emplace_back([this, i] { workerMain(i); });
+    }
+
+    ThreadPool(ThreadPool &&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard lock(mSleepMutex);
+            mStopping = true;
+        }
+        mSleepCondition.notify_all();
+        for (auto &worker: mWorkers)
+            worker.join();
+    }
+
+    void submit(std::function<void()> job) {
+        std::size_t index = tCurrentPool == this
+                                ? tCurrentIndex
+                                : mNextQueue.fetch_add(1, std::memory_order_relaxed) % mQueues.size();
+        mPendingJobs.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard lock(mQueues[index]->mMutex);
+            mQueues[index]->mJobs.push_back(std::move(job));
+        }
+        {
+            // 与 workerMain 检查条件时持有的锁同步，避免丢失唤醒
+            std::lock_guard lock(mSleepMutex);
+        }
+        mSleepCondition.notify_one();
+    }
+
+    std::size_t size() const noexcept {
+        return mWorkers.size();
+    }
+
+private:
+    struct WorkQueue {
+        std::mutex mMutex;
+        std::deque<std::function<void()> > mJobs;
+    };
+
+    bool popLocal(std::size_t index, std::function<void()> &job) {
+        auto &queue = *mQueues[index];
+        std::lock_guard lock(queue.mMutex);
+        if (queue.mJobs.empty())
+            return false;
+        job = std::move(queue.mJobs.back());
+        queue.mJobs.pop_back();
+        return true;
+    }
+
+    bool steal(std::size_t index, std::function<void()> &job) {
+        for (std::size_t i = 1; i < mQueues.size(); ++i) {
+            auto &queue = *mQueues[(index + i) % mQueues.size()];
+            std::lock_guard lock(queue.mMutex);
+            if (queue.mJobs.empty())
+                continue;
+            job = std::move(queue.mJobs.front());
+            queue.mJobs.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    void workerMain(std::size_t index) {
+        tCurrentPool = this;
+        tCurrentIndex = index;
+        std::function<void()> job;
+        while (true) {
+            if (popLocal(index, job) || steal(index, job)) {
+                mPendingJobs.fetch_sub(1, std::memory_order_relaxed);
+                job();
+                job = nullptr;
+                continue;
+            }
+            std::unique_lock lock(mSleepMutex);
+            mSleepCondition.wait(lock, [this] {
+                return mStopping || mPendingJobs.load(std::memory_order_relaxed) != 0;
+            });
+            if (mStopping && mPendingJobs.load(std::memory_order_relaxed) == 0)
+                return;
+        }
+    }
+
+    static inline thread_local ThreadPool *tCurrentPool = nullptr;
+    static inline thread_local std::size_t tCurrentIndex = 0;
+
+    std::vector<std::unique_ptr<WorkQueue> > mQueues;
+    std::atomic<std::size_t> mNextQueue{0};
+    std::atomic<std::size_t> mPendingJobs{0};
+    std::mutex mSleepMutex;
+    std::condition_variable mSleepCondition;
+    bool mStopping{false};
+    std::vector<std::thread> mWorkers;
+};
+
+inline ThreadPool &getThreadPool() {
+    static ThreadPool pool;
+    return pool;
+}
+
+// 把 mFunc 放到线程池里执行，执行完毕后协程回到 Loop 所在线程继续
+template<class F>
+struct OffloadAwaiter {
+    using RetType = std::invoke_result_t<F &>;
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> coroutine) {
+        mLoop.expectRemote();
+        mPool.submit([this, coroutine] {
+            try {
+                if constexpr (std::is_void_v<RetType>) {
+                    std::invoke(mFunc);
+                } else {
+                    mResult.putValue(std::invoke(mFunc));
+                }
+            } catch (...) {
+                mException = std::current_exception();
+            }
+            mLoop.postTask(coroutine);
+        });
+    }
+
+    RetType await_resume() {
+        if (mException) [[unlikely]] {
+            std::rethrow_exception(mException);
+        }
+        if constexpr (!std::is_void_v<RetType>) {
+            return mResult.moveValue();
+        }
+    }
+
+    ThreadPool &mPool;
+    Loop &mLoop;
+    F mFunc;
+    std::exception_ptr mException{};
+    Uninitialized<RetType> mResult{};
+};
+
+template<class F>
+auto offload(ThreadPool &pool, F func) {
+    return OffloadAwaiter<F>(pool, getLoop(), std::move(func));
+}
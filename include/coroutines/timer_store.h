@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "rbtree.h"
+
+struct TimerShard;
+
+// 可以在任意线程上设置、取消的定时器，到期后回调在 Loop 所在线程上执行
+// 析构时自动取消；cancel 返回 false 说明回调已经或即将执行，这时要由调用者自己和回调同步
+// 同一个定时器的 arm 和 cancel 不能在多个线程上同时进行
+struct ConcurrentTimer : RbTree<ConcurrentTimer, std::less<>, RbCompactNode>::RbNode {
+    ConcurrentTimer() = default;
+
+    ConcurrentTimer(ConcurrentTimer &&) = delete;
+
+    ~ConcurrentTimer() {
+        cancel();
+    }
+
+    bool cancel() noexcept;
+
+    bool armed() const noexcept {
+        return mShard.load(std::memory_order_acquire) != nullptr;
+    }
+
+    ConcurrentTimer &operator=(ConcurrentTimer &&) = delete;
+
+    friend bool operator<(ConcurrentTimer const &lhs, ConcurrentTimer const &rhs) noexcept {
+        return lhs.mExpireTime < rhs.mExpireTime;
+    }
+
+    std::chrono::system_clock::time_point mExpireTime{};
+    std::function<void()> mCallback{};
+    std::atomic<TimerShard *> mShard{nullptr};
+};
+
+// 一个分片：一把锁保护一棵树，最早的到期时间另存一份原子变量，Loop 不加锁就能判断要不要进来
+struct alignas(64) TimerShard {
+    static constexpr std::int64_t kNever = std::numeric_limits<std::int64_t>::max();
+
+    // 以下两个函数都要在持有 mMutex 时调用
+    void insert(ConcurrentTimer &timer) {
+        mTimers.insert(timer);
+        timer.mShard.store(this, std::memory_order_release);
+        update();
+    }
+
+    bool erase(ConcurrentTimer &timer) noexcept {
+        if (timer.mShard.load(std::memory_order_relaxed) != this)
+            return false;
+        mTimers.erase(timer);
+        timer.mShard.store(nullptr, std::memory_order_release);
+        update();
+        return true;
+    }
+
+    // 顺序一致：Loop 的 prepareWait 先写截止时间再读这里，armTimer 先写这里再读截止时间
+    void update() noexcept {
+        mEarliest.store(mTimers.empty() ? kNever : mTimers.front().mExpireTime.time_since_epoch().count());
+        mSize.store(mTimers.size(), std::memory_order_relaxed);
+    }
+
+    std::mutex mMutex;
+    RbTree<ConcurrentTimer, std::less<>, RbCompactNode> mTimers;
+    std::atomic<std::int64_t> mEarliest{kNever};
+    std::atomic<std::size_t> mSize{0};
+};
+
+inline bool ConcurrentTimer::cancel() noexcept {
+    TimerShard *shard = mShard.load(std::memory_order_acquire);
+    if (shard == nullptr)
+        return false;
+    std::lock_guard lock(shard->mMutex);
+    return shard->erase(*this);
+}
+
+// 按线程分片的定时器集合：各线程设置定时器时只锁自己的分片，
+// Loop 消费到期定时器时只锁确实有定时器到期的分片，没有全局锁
+struct ConcurrentTimerStore {
+    static constexpr std::size_t kShards = 16;
+
+    // 要不要叫醒 Loop 由调用者在插入之后决定，见 BasicLoop::armTimer
+    void arm(ConcurrentTimer &timer, std::chrono::system_clock::time_point expireTime,
+             std::function<void()> callback) {
+        timer.cancel();
+        auto &shard = mShards[shardIndex()];
+        std::lock_guard lock(shard.mMutex);
+        timer.mExpireTime = expireTime;
+        timer.mCallback = std::move(callback);
+        shard.insert(timer);
+    }
+
+    std::optional<std::chrono::system_clock::time_point> earliest() const noexcept {
+        std::int64_t count = earliestCount();
+        if (count == TimerShard::kNever)
+            return std::nullopt;
+        return std::chrono::system_clock::time_point(std::chrono::system_clock::duration(count));
+    }
+
+    std::size_t size() const noexcept {
+        std::size_t total = 0;
+        for (auto const &shard: mShards)
+            total += shard.mSize.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    // 只在 Loop 线程上调用：取出所有到期的定时器，按到期时间顺序在锁外执行回调
+    // 返回执行了多少个回调
+    std::size_t fireExpired(std::chrono::system_clock::time_point now) {
+        auto nowCount = now.time_since_epoch().count();
+        std::vector<std::pair<std::chrono::system_clock::time_point, std::function<void()> > > firing;
+        for (auto &shard: mShards) {
+            if (shard.mEarliest.load(std::memory_order_acquire) > nowCount)
+                continue;
+            std::lock_guard lock(shard.mMutex);
+            while (!shard.mTimers.empty() && shard.mTimers.front().mExpireTime <= now) {
+                auto &timer = shard.mTimers.front();
+                // 回调搬出来之后就不再碰 timer，cancel 返回 false 后对方可以立即销毁它
+                firing.emplace_back(timer.mExpireTime, std::move(timer.mCallback));
+                shard.erase(timer);
+            }
+        }
+        std::stable_sort(firing.begin(), firing.end(), [](auto const &lhs, auto const &rhs) {
+            return lhs.first < rhs.first;
+        });
+        for (auto &[expireTime, callback]: firing)
+            callback();
+        return firing.size();
+    }
+
+private:
+    std::int64_t earliestCount() const noexcept {
+        std::int64_t count = TimerShard::kNever;
+        for (auto const &shard: mShards)
+            count = std::min(count, shard.mEarliest.load());
+        return count;
+    }
+
+    static std::size_t shardIndex() noexcept {
+        static thread_local std::size_t index =
+            std::hash<std::thread::id>()(std::this_thread::get_id()) % kShards;
+        return index;
+    }
+
+    std::array<TimerShard, kShards> mShards{};
+};
@@ -0,0 +1,9 @@
+// 模块接口：import debugger; 得到与包含 debugger.h 相同的 debug
+// 是否定义 NDEBUG 在编译模块时就决定了，使用方的 NDEBUG 不再起作用
+module;
+
+#include "debugger.h"
+
+export module debugger;
+
+export using ::debug;
@@ -5,13 +5,16 @@
 #include <cstdint>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #if DEBUG_SHOW_SOURCE
 #include <fstream>
 #include <unordered_map>
 #endif
 #include <source_location>
+#include <tuple>
 #include <type_traits>
 #include <typeinfo>
+#include <utility>
 #include <sstream>
 #include <memory>
 #if defined(__unix__) || defined(__clang__) && __has_include(<cxxabi.h>)
@@ -23,6 +26,52 @@
 #else
 #endif
 
+// uni_format 按顺序尝试的各种格式化方式，写成具名 concept 后编译器对每个类型只判断一次
+namespace debug_details {
+template <class T0>
+concept ostreamable = requires(std::ostream &oss, T0 &&t) {
+    oss << std::forward<T0>(t);
+};
+
+template <class T0>
+concept to_stringable = requires(T0 &&t) {
+    std::to_string(std::forward<T0>(t));
+};
+
+template <class T0>
+concept iterable = requires(T0 &&t) {
+    std::begin(std::forward<T0>(t)) != std::end(std::forward<T0>(t));
+};
+
+template <class T>
+concept tuple_like = requires { std::tuple_size<T>::value; };
+
+template <class T0>
+concept member_repr = requires(T0 &&t) { std::forward<T0>(t).repr(); };
+
+template <class T0>
+concept member_repr_to = requires(std::ostream &oss, T0 &&t) {
+    std::forward<T0>(t).repr(oss);
+};
+
+template <class T0>
+concept adl_repr = requires(T0 &&t) { repr(std::forward<T0>(t)); };
+
+template <class T0>
+concept adl_repr_to = requires(std::ostream &oss, T0 &&t) {
+    repr(oss, std::forward<T0>(t));
+};
+
+template <class T0>
+concept pointer_like = requires(T0 const &t) {
+    (*t);
+    (bool)t;
+};
+
+template <class T0>
+concept visitable = requires(T0 const &t) { visit([](auto const &) {}, t); };
+} // namespace debug_details
+
 struct debug {
 private:
     std::ostringstream oss;
@@ -84,6 +133,13 @@ private:
         return s;
     }
 
+    // 逐个下标展开 tuple 的元素，比 std::apply 套 lambda 少实例化很多层
+    template <class Tuple, std::size_t... Is>
+    static void uni_format_elements(std::ostream &oss, Tuple &t,
+                                    std::index_sequence<Is...>) {
+        ((oss << (Is == 0 ? "" : ", "), uni_format(oss, std::get<Is>(t))), ...);
+    }
+
     template <class T0>
     static void uni_format(std::ostream &oss, T0 &&t) {
         using T = std::decay_t<T0>;
@@ -121,18 +177,11 @@ private:
             oss << std::fixed
                 << std::setprecision(std::numeric_limits<T>::digits10) << t;
             oss.flags(f);
-        } else if constexpr (requires(std::ostream &oss, T0 &&t) {
-                                 oss << std::forward<T0>(t);
-                             }) {
+        } else if constexpr (debug_details::ostreamable<T0>) {
             oss << std::forward<T0>(t);
-        } else if constexpr (requires(T0 &&t) {
-                                 std::to_string(std::forward<T0>(t));
-                             }) {
+        } else if constexpr (debug_details::to_stringable<T0>) {
             oss << std::to_string(std::forward<T0>(t));
-        } else if constexpr (requires(T0 &&t) {
-                                 std::begin(std::forward<T0>(t)) !=
-                                     std::end(std::forward<T0>(t));
-                             }) {
+        } else if constexpr (debug_details::iterable<T0>) {
             oss << '{';
             bool add_comma = false;
             for (auto &&i: t) {
@@ -142,58 +191,30 @@ private:
                 uni_format(oss, std::forward<decltype(i)>(i));
             }
             oss << '}';
-        } else if constexpr (requires(T0 &&t) {
-                                 /* []<std::size_t... Is>( */
-                                 /*     T &&t, std::index_sequence<Is...>) { */
-                                 /*     void (*f)(...) = nullptr; */
-                                 /*     f(std::get<Is>(t)...); */
-                                 /* }(std::forward<T0>(t), */
-                                 /*   std::make_index_sequence< */
-                                 std::tuple_size<T>::value
-                                     /* >{}) */
-                                     ;
-                             }) {
+        } else if constexpr (debug_details::tuple_like<T>) {
             oss << '{';
-            bool add_comma = false;
-            std::apply(
-                [&](auto &&...args) {
-                    (([&] {
-                         if (add_comma)
-                             oss << ", ";
-                         add_comma = true;
-                         (uni_format)(oss, std::forward<decltype(args)>(args));
-                     }()), ...);
-                },
-                t);
+            uni_format_elements(oss, t,
+                                std::make_index_sequence<std::tuple_size<T>::value>{});
             oss << '}';
         } else if constexpr (std::is_enum_v<T>) {
             uni_format(oss, static_cast<std::underlying_type_t<T>>(t));
         } else if constexpr (std::is_same_v<T, std::type_info>) {
             oss << uni_demangle(t.name());
-        } else if constexpr (requires(T0 &&t) { std::forward<T0>(t).repr(); }) {
+        } else if constexpr (debug_details::member_repr<T0>) {
             uni_format(oss, std::forward<T0>(t).repr());
-        } else if constexpr (requires(T0 &&t) {
-                                 std::forward<T0>(t).repr(oss);
-                             }) {
+        } else if constexpr (debug_details::member_repr_to<T0>) {
             std::forward<T0>(t).repr(oss);
-        } else if constexpr (requires(T0 &&t) { repr(std::forward<T0>(t)); }) {
+        } else if constexpr (debug_details::adl_repr<T0>) {
             uni_format(oss, repr(std::forward<T0>(t)));
-        } else if constexpr (requires(T0 &&t) {
-                                 repr(oss, std::forward<T0>(t));
-                             }) {
+        } else if constexpr (debug_details::adl_repr_to<T0>) {
             repr(oss, std::forward<T0>(t));
-        } else if constexpr (requires(T0 const &t) {
-                                 (*t);
-                                 (bool)t;
-                             }) {
+        } else if constexpr (debug_details::pointer_like<T0>) {
             if ((bool)t) {
                 uni_format(oss, *t);
             } else {
                 oss << "nil";
             }
-        } else if constexpr (requires(T0 const &t) {
-                                 visit([](auto const &) {}, t);
-                             }) {
+        } else if constexpr (debug_details::visitable<T0>) {
             visit([&oss](auto const &t) { uni_format(oss, t); }, t);
         } else {
             oss << '[' << uni_demangle(typeid(t).name()) << " at "
@@ -0,0 +1,8 @@
+// 模块接口：import demangle; 得到与包含 demangle.h 相同的 demangle
+module;
+
+#include "demangle.h"
+
+export module demangle;
+
+export using demangle_details::demangle;
@@ -0,0 +1,33 @@
+// 模块接口：import print; 得到与包含 print.h、print_json.h、print_deferred.h 相同的公开名字
+// 实现仍然只在头文件里，这里在全局模块片段中包含它们再导出，使用方只需解析一次预编译好的模块
+module;
+
+#include "print.h"
+#include "print_json.h"
+#include "print_deferred.h"
+
+export module print;
+
+export using printer_details::print;
+export using printer_details::printnl;
+export using printer_details::eprint;
+export using printer_details::eprintnl;
+export using printer_details::to_string;
+export using printer_details::print_buffer;
+export using printer_details::print_options;
+export using printer_details::set_print_options;
+export using printer_details::get_print_options;
+export using printer_details::print_sink;
+export using printer_details::fd_sink;
+export using printer_details::span_sink;
+#if defined(__unix__) || defined(__APPLE__)
+export using printer_details::mmap_sink;
+#endif
+#if defined(__cpp_lib_format)
+export using printer_details::printable;
+#endif
+export using printer_details::append_json;
+export using printer_details::to_json;
+export using printer_details::print_json;
+export using printer_details::print_deferred;
+export using printer_details::flush_deferred;
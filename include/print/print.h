@@ -6,183 +6,484 @@
 #include <map>
 #include <optional>
 #include <variant>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <version>
+#if defined(__cpp_lib_format)
+#include <format>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#if defined(__GLIBC__)
+#include <stdio_ext.h>
+#endif
 
 
 namespace printer_details {
-    template<typename T, typename = void>
-    struct is_tuple : std::false_type {
-    };
+    // 类型分类都写成 concept：编译器按类型缓存满足与否，不像 enable_if/void_t 那样每个类型要实例化一串 trait 类模板，
+    // 分派时也不再需要 SFINAE 的重载决议
+    template<typename T, template<typename...> class Template>
+    constexpr bool _is_instance_of = false;
+
+    template<template<typename...> class Template, typename... Ts>
+    constexpr bool _is_instance_of<Template<Ts...>, Template> = true;
 
     template<typename T>
-    struct is_tuple<T, std::void_t<decltype(std::tuple_size<T>::value)> > : std::true_type {
-    };
+    constexpr bool _is_std_array = false;
+
+    template<typename T, std::size_t N>
+    constexpr bool _is_std_array<std::array<T, N> > = true;
+
+    template<typename T, typename... Ts>
+    concept is_one_of = (std::is_same_v<T, Ts> || ...);
 
     template<typename T>
-    struct is_array : std::false_type {
-    };
+    concept is_char = is_one_of<T, char, wchar_t, char8_t, char16_t, char32_t>;
 
     template<typename T>
-    struct is_array<T[]> : std::true_type {
-    };
+    concept is_tuple = requires { std::tuple_size<T>::value; };
 
-    template<typename T, std::size_t N>
-    struct is_array<std::array<T, N> > : std::true_type {
-    };
+    template<typename T>
+    concept is_array = std::is_array_v<T> || _is_std_array<T>;
 
-    template<typename T, std::size_t N>
-    struct is_array<T[N]> : std::true_type {
+    template<typename T>
+    concept is_map = requires {
+        typename T::key_type;
+        typename T::mapped_type;
+        requires std::is_same_v<typename T::value_type, std::pair<typename T::key_type const, typename T::mapped_type> >;
     };
 
-    template<typename T, typename = void>
-    struct is_map : std::false_type {
-    };
+    template<typename T>
+    concept is_optional = _is_instance_of<T, std::optional>;
 
     template<typename T>
-    struct is_map<T, std::enable_if_t<std::is_same_v<typename T::value_type, std::pair<typename T::key_type const,
-                typename T::mapped_type> > > > : std::true_type {
-    };
+    concept is_variant = _is_instance_of<T, std::variant>;
 
     template<typename T>
-    struct is_optional : std::false_type {
-    };
+    concept is_string = (_is_instance_of<T, std::basic_string> || _is_instance_of<T, std::basic_string_view>) &&
+                        is_char<typename T::value_type>;
 
     template<typename T>
-    struct is_optional<std::optional<T> > : std::true_type {
-    };
+    concept is_c_str = std::is_pointer_v<std::decay_t<T> > &&
+                       is_char<std::remove_const_t<std::remove_pointer_t<std::decay_t<T> > > >;
 
     template<typename T>
-    struct is_variant : std::false_type {
+    concept is_iterable = requires(T const &t) { std::begin(t); };
+
+    // 打印巨大或嵌套很深的容器时的限制，默认都不限制；超出的部分显示为 ...
+    struct print_options {
+        std::size_t max_elements = std::numeric_limits<std::size_t>::max(); // 每个容器最多输出多少个元素
+        std::size_t max_depth = std::numeric_limits<std::size_t>::max();    // 更深的容器整个显示为 [...]
+        std::size_t max_bytes = std::numeric_limits<std::size_t>::max();    // 一次调用最多输出多少字节
+        std::size_t chunk_size = 0; // 非零时 print 每攒够这么多字节就先写出一块，内存占用与输出长度无关，但一行不再是原子写出
     };
 
-    template<typename... Ts>
-    struct is_variant<std::variant<Ts...> > : std::true_type {
-    };
+    inline std::atomic<std::size_t> _max_elements{std::numeric_limits<std::size_t>::max()};
+    inline std::atomic<std::size_t> _max_depth{std::numeric_limits<std::size_t>::max()};
+    inline std::atomic<std::size_t> _max_bytes{std::numeric_limits<std::size_t>::max()};
+    inline std::atomic<std::size_t> _chunk_size{0};
+
+    // 对之后所有线程的 print/to_string/printable 生效；与正在进行的打印并发修改时，各字段可能新旧混用
+    inline void set_print_options(print_options const &options) noexcept {
+        _max_elements.store(options.max_elements, std::memory_order_relaxed);
+        _max_depth.store(options.max_depth, std::memory_order_relaxed);
+        _max_bytes.store(options.max_bytes, std::memory_order_relaxed);
+        _chunk_size.store(options.chunk_size, std::memory_order_relaxed);
+    }
 
-    template<typename T, typename... Ts>
-    struct is_one_of : std::disjunction<std::is_same<T, Ts>...> {
+    inline print_options get_print_options() noexcept {
+        return {
+            _max_elements.load(std::memory_order_relaxed),
+            _max_depth.load(std::memory_order_relaxed),
+            _max_bytes.load(std::memory_order_relaxed),
+            _chunk_size.load(std::memory_order_relaxed),
+        };
+    }
+
+    // 各种字符输出的公共部分：派生类提供 put、append 和 append_chars，这里按类型分派 operator<<
+    // 算术类型用 std::to_chars（浮点按 %g 六位有效数字，与 ostream 默认输出一致），字符串整段追加，
+    // 其余类型退回到它自己的 operator<<
+    template<typename Derived>
+    struct _char_sink {
+        template<typename T>
+        Derived &operator<<(T const &val) {
+            auto &self = static_cast<Derived &>(*this);
+            if constexpr (std::is_same_v<T, char> || std::is_same_v<T, signed char> || std::is_same_v<T, unsigned char>) {
+                self.put(char(val));
+            } else if constexpr (std::is_same_v<T, bool>) {
+                self.put(val ? '1' : '0');
+            } else if constexpr (is_char<T>) {
+                // 宽字符和 UTF 字符按整数输出只会得到码点，宁可编译不过
+                static_assert(std::is_same_v<T, char>, "print only supports char; convert wide and UTF characters first");
+            } else if constexpr (std::is_integral_v<T>) {
+                self.append_chars(val);
+            } else if constexpr (std::is_floating_point_v<T>) {
+                self.append_chars(val, std::chars_format::general, 6);
+            } else if constexpr (std::is_convertible_v<T const &, std::string_view>) {
+                self.append(std::string_view(val));
+            } else {
+                std::ostringstream oss;
+                oss << val;
+                self.append(oss.view());
+            }
+            return self;
+        }
+
+        // 派生类能确定后面的输出都会被丢弃时返回 true，容器就不必再往下遍历
+        bool exhausted() const noexcept {
+            return false;
+        }
+
+        print_options m_options = get_print_options();
+        std::size_t m_depth = 0;
     };
 
-    template<typename T>
-#if __cplusplus >= 202002L
-    struct is_char : is_one_of<T, char, wchar_t, char8_t, char16_t, char32_t> {
+    template<typename Os>
+    constexpr bool is_char_sink_v = std::is_base_of_v<_char_sink<Os>, Os>;
+
+    // 进入一层容器；超过 max_depth 时输出 ... 并返回 false，调用者跳过内容
+    template<typename Os>
+    bool _enter(Os &os) {
+        if constexpr (is_char_sink_v<Os>) {
+            if (os.m_depth >= os.m_options.max_depth) {
+                os << "...";
+                return false;
+            }
+            ++os.m_depth;
+        }
+        return true;
+    }
+
+    template<typename Os>
+    void _leave(Os &os) {
+        if constexpr (is_char_sink_v<Os>)
+            --os.m_depth;
+    }
+
+    // 容器里第 index 个元素之前调用，返回 true 时输出 ... 并结束遍历
+    template<typename Os>
+    bool _elide(Os &os, std::size_t index) {
+        if constexpr (is_char_sink_v<Os>) {
+            if (index >= os.m_options.max_elements || os.exhausted()) {
+                os << "...";
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // print 的输出目标：有 write(char const *, std::size_t) 成员的类型都可以，包括 std::ostream
+    template<typename S>
+    concept print_sink = requires(S &sink, char const *p, std::size_t n) { sink.write(p, n); };
+
+    // 抹掉类型的 sink 引用，print_buffer 和 _print_line 不必按 sink 类型各实例化一份
+    class _sink_ref {
+    public:
+        _sink_ref() = default;
+
+        template<typename S> requires print_sink<S> && (!std::is_same_v<std::remove_const_t<S>, _sink_ref>)
+        _sink_ref(S &sink) noexcept
+            : m_sink(const_cast<void *>(static_cast<void const *>(&sink))),
+              m_write([](void *sink, char const *p, std::size_t n) {
+                  static_cast<S *>(sink)->write(p, n);
+              }) {
+        }
+
+        explicit operator bool() const noexcept {
+            return m_write != nullptr;
+        }
+
+        void write(char const *p, std::size_t n) const {
+            m_write(m_sink, p, n);
+        }
+
+    private:
+        void *m_sink = nullptr;
+        void (*m_write)(void *, char const *, std::size_t) = nullptr;
     };
+
+    // 标准输出可能还有 printf 或 std::cout 留在 stdio 缓冲区里的内容，写之前先冲掉以保持先后顺序；
+    // fflush 要拿 FILE 的锁，多线程同时打印时会互相争抢，所以 glibc 上先看一眼有没有积压
+    inline void _flush_stdio(std::FILE *file) {
+#if defined(__GLIBC__)
+        if (__fpending(file) == 0)
+            return;
+#endif
+        std::fflush(file);
+    }
+
+    // 整块用一次 write 写出（只有被信号打断或管道写满时才会分多次），各线程的行之间不会交错
+    // （管道上单次不超过 PIPE_BUF 时由内核保证原子）
+    inline void _write_fd(int fd, char const *p, std::size_t n) {
+        if (fd == 1 || fd == 2)
+            _flush_stdio(fd == 2 ? stderr : stdout);
+#if defined(__unix__) || defined(__APPLE__)
+        while (n != 0) {
+            ssize_t written = ::write(fd, p, n);
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+            p += written;
+            n -= std::size_t(written);
+        }
 #else
-struct is_char : is_one_of<T, char, wchar_t, char16_t, char32_t> {};
+        std::FILE *file = fd == 2 ? stderr : stdout;
+        std::fwrite(p, 1, n, file);
+        std::fflush(file);
 #endif
+    }
 
-    template<typename T, typename = void>
-    struct is_string : std::false_type {
-    };
+    // 连续的可增长字符缓冲区，print 系列先把整行格式化到这里，再一次性写出
+    class print_buffer : public _char_sink<print_buffer> {
+    public:
+        print_buffer() = default;
 
-    template<typename T>
-    struct is_string<std::basic_string<T>, std::enable_if_t<is_char<T>::value> > : std::true_type {
-    };
+        print_buffer(print_buffer const &) = delete;
 
-    template<typename T>
-    struct is_string<std::basic_string_view<T>, std::enable_if_t<is_char<T>::value> > : std::true_type {
-    };
+        print_buffer &operator=(print_buffer const &) = delete;
 
-    template<typename T>
-    struct is_c_str : std::conjunction<std::is_pointer<std::decay_t<T> >, is_char<std::remove_const_t<
-                std::remove_pointer_t<std::decay_t<T> > > > > {
-    };
+        void put(char c) {
+            if (m_truncated)
+                return;
+            if (m_size == m_capacity)
+                make_room(1);
+            m_data[m_size++] = c;
+            check_limit();
+        }
 
-    template<typename T, typename = void>
-    struct is_iterable : std::false_type {
-    };
+        void append(char const *s, std::size_t n) {
+            if (m_truncated)
+                return;
+            if (m_capacity - m_size < n)
+                make_room(n);
+            std::memcpy(m_data + m_size, s, n);
+            m_size += n;
+            check_limit();
+        }
 
-    template<typename T>
-    struct is_iterable<T, std::void_t<decltype(std::begin(std::declval<T const &>()))> > : std::true_type {
-    };
+        void append(std::string_view s) {
+            append(s.data(), s.size());
+        }
 
-    template<typename T>
-    constexpr bool is_map_v = is_map<T>::value;
+        char const *data() const noexcept {
+            return m_data;
+        }
 
-    template<typename T>
-    constexpr bool is_optional_v = is_optional<T>::value;
+        std::size_t size() const noexcept {
+            return m_size;
+        }
 
-    template<typename T>
-    constexpr bool is_variant_v = is_variant<T>::value;
+        std::string_view view() const noexcept {
+            return {m_data, m_size};
+        }
 
-    template<typename T>
-    constexpr bool is_char_v = is_char<T>::value;
+        std::size_t capacity() const noexcept {
+            return m_capacity;
+        }
 
-    template<typename T>
-    constexpr bool is_string_v = is_string<T>::value;
+        bool exhausted() const noexcept {
+            return m_truncated;
+        }
 
-    template<typename T>
-    constexpr bool is_c_str_v = is_c_str<T>::value;
+        // 开始一次新的输出：清空内容，按 options 设置限制；给了 stream 且设置了 chunk_size 时边格式化边写出
+        void begin(print_options const &options, _sink_ref stream = {}) noexcept {
+            m_options = options;
+            m_depth = 0;
+            m_size = 0;
+            m_flushed = 0;
+            m_truncated = false;
+            m_limit = options.max_bytes;
+            m_stream = options.chunk_size != 0 ? stream : _sink_ref();
+        }
 
-    template<typename T>
-    constexpr bool is_iterable_v = is_iterable<T>::value;
+        // 解除字节数限制，print 用它在截断之后仍然输出换行
+        void lift_limit() noexcept {
+            m_limit = std::numeric_limits<std::size_t>::max();
+            m_truncated = false;
+        }
 
-    template<typename T>
-    constexpr bool is_tuple_v = is_tuple<T>::value;
+        void clear() noexcept {
+            m_size = 0;
+        }
 
-    template<typename T>
-    constexpr bool is_array_v = is_array<T>::value;
+        // 清空并在容量超过 keep 时归还堆内存，给长期复用的缓冲区用
+        void trim(std::size_t keep) noexcept {
+            m_size = 0;
+            if (m_capacity > keep && m_heap) {
+                m_heap.reset();
+                m_data = m_inline;
+                m_capacity = sizeof(m_inline);
+            }
+        }
+
+        // 把缓冲区的内容交给 fd 或 sink 并清空
+        void write_to(int fd) {
+            _write_fd(fd, m_data, m_size);
+            m_size = 0;
+        }
+
+        void write_to(_sink_ref sink) {
+            sink.write(m_data, m_size);
+            m_size = 0;
+        }
+
+    private:
+        friend struct _char_sink<print_buffer>;
+
+        template<typename T, typename... Args>
+        void append_chars(T val, Args... args) {
+            if (m_truncated)
+                return;
+            // 64 字节放得下任何整数和 %g 格式的浮点数
+            if (m_capacity - m_size < 64)
+                make_room(64);
+            auto result = std::to_chars(m_data + m_size, m_data + m_capacity, val, args...);
+            m_size = std::size_t(result.ptr - m_data);
+            check_limit();
+        }
 
-    template<typename T, typename = void>
+        // 截断时追加 ... 可能要扩容或先把已有内容交给 sink，两者都可能抛异常
+        void check_limit() {
+            if (m_flushed + m_size > m_limit) [[unlikely]] {
+                m_size = m_limit - m_flushed;
+                m_truncated = true;
+                if (m_capacity - m_size < 3)
+                    make_room(3);
+                std::memcpy(m_data + m_size, "...", 3);
+                m_size += 3;
+            }
+        }
+
+        // 流式输出时攒够一块就先写出去，否则扩容
+        void make_room(std::size_t n) {
+            if (m_stream && m_size != 0 && m_size + n > m_options.chunk_size) {
+                m_flushed += m_size;
+                write_to(m_stream);
+            }
+            if (m_capacity - m_size < n)
+                grow(n);
+        }
+
+        void grow(std::size_t n) {
+            std::size_t capacity = std::max(m_capacity * 2, m_size + n);
+            auto heap = std::make_unique_for_overwrite<char[]>(capacity);
+            std::memcpy(heap.get(), m_data, m_size);
+            m_heap = std::move(heap);
+            m_data = m_heap.get();
+            m_capacity = capacity;
+        }
+
+        char m_inline[256];
+        std::unique_ptr<char[]> m_heap;
+        char *m_data = m_inline;
+        std::size_t m_size = 0;
+        std::size_t m_capacity = sizeof(m_inline);
+        std::size_t m_flushed = 0;
+        std::size_t m_limit = std::numeric_limits<std::size_t>::max();
+        _sink_ref m_stream;
+        bool m_truncated = false;
+    };
+
+    template<typename T>
     struct _printer {
-        static void print(std::ostream &os, T const &val) {
+        template<typename Os>
+        static void print(Os &os, T const &val) {
             os << val;
         }
     };
 
-    template<class T>
-    struct _printer<T, std::enable_if_t<is_char_v<T> > > {
-        static void print(std::ostream &os, T const &t) {
-            T s[2] = {t, T('\0')};
-            os << std::quoted(s, T('\''));
+    template<typename T> requires is_char<T>
+    struct _printer<T> {
+        template<typename Os>
+        static void print(Os &os, T const &t) {
+            os << T('\'');
+            if (t == T('\'') || t == T('\\'))
+                os << T('\\');
+            os << t << T('\'');
         }
     };
 
-    template<typename T>
-    struct _printer<T, std::enable_if_t<is_tuple_v<T> && !is_array_v<T>> > {
-        static void print(std::ostream &os, T const &val) {
+    template<typename T> requires is_tuple<T> && (!is_array<T>)
+    struct _printer<T> {
+        template<typename Os>
+        static void print(Os &os, T const &val) {
             os << "(";
-            bool once = false;
-            std::apply([&os, &once](auto const &... args) {
-                ((once ? os << ", " : os, once = true, _printer<std::remove_cvref_t<decltype(args)> >::print(os, args)),
-                    ...);
-            }, val);
+            if (_enter(os)) {
+                print_elements(os, val, std::make_index_sequence<std::tuple_size_v<T> >{});
+                _leave(os);
+            }
             os << ")";
         }
+
+        // 直接展开下标，不经过 std::apply 和泛型 lambda，每个 tuple 类型少实例化一整条 invoke 链
+        template<typename Os, std::size_t... Is>
+        static void print_elements(Os &os, T const &val, std::index_sequence<Is...>) {
+            ((Is != 0 ? os << ", " : os, _printer<std::remove_cvref_t<std::tuple_element_t<Is, T> > >::print(os, std::get<Is>(val))),
+                ...);
+        }
     };
 
-    template<typename T>
-    struct _printer<T, std::enable_if_t<is_iterable_v<T> && !is_map_v<T> && !is_c_str_v<T> && !is_string_v<T>> > {
-        static void print(std::ostream &os, T const &val) {
+    template<typename T> requires is_iterable<T> && (!is_map<T>) && (!is_c_str<T>) && (!is_string<T>)
+    struct _printer<T> {
+        template<typename Os>
+        static void print(Os &os, T const &val) {
             os << "[";
-            bool once = false;
-            for (auto const &v: val) {
-                if (once) os << ", ";
-                once = true;
-                _printer<std::remove_cvref_t<decltype(v)> >::print(os, v);
+            if (_enter(os)) {
+                std::size_t index = 0;
+                for (auto const &v: val) {
+                    if (index != 0) os << ", ";
+                    if (_elide(os, index++)) break;
+                    _printer<std::remove_cvref_t<decltype(v)> >::print(os, v);
+                }
+                _leave(os);
             }
             os << "]";
         }
     };
 
-    template<typename T>
-    struct _printer<T, std::enable_if_t<is_map_v<T> > > {
-        static void print(std::ostream &os, T const &val) {
+    template<typename T> requires is_map<T>
+    struct _printer<T> {
+        template<typename Os>
+        static void print(Os &os, T const &val) {
             os << "{";
-            bool once = false;
-            for (auto const &[k, v]: val) {
-                if (once) os << ", ";
-                once = true;
-                _printer<typename T::key_type>::print(os, k);
-                os << ": ";
-                _printer<typename T::mapped_type>::print(os, v);
+            if (_enter(os)) {
+                std::size_t index = 0;
+                for (auto const &[k, v]: val) {
+                    if (index != 0) os << ", ";
+                    if (_elide(os, index++)) break;
+                    _printer<typename T::key_type>::print(os, k);
+                    os << ": ";
+                    _printer<typename T::mapped_type>::print(os, v);
+                }
+                _leave(os);
             }
             os << "}";
         }
     };
 
-    template<typename T>
-    struct _printer<T, std::enable_if_t<is_optional_v<T> > > {
-        static void print(std::ostream &os, T const &val) {
+    template<typename T> requires is_optional<T>
+    struct _printer<T> {
+        template<typename Os>
+        static void print(Os &os, T const &val) {
             if (val.has_value()) {
                 _printer<typename T::value_type>::print(os, val.value());
             } else {
@@ -191,83 +492,388 @@ struct is_char : is_one_of<T, char, wchar_t, char16_t, char32_t> {};
         }
     };
 
-    template<typename T>
-    struct _printer<T, std::enable_if_t<is_variant_v<T> > > {
-        static void print(std::ostream &os, T const &val) {
-            std::visit([&os](auto const &v) {
-                _printer<std::remove_cvref_t<decltype(v)> >::print(os, v);
-            }, val);
+    template<typename T> requires is_variant<T>
+    struct _printer<T> {
+        template<typename Os>
+        static void print(Os &os, T const &val) {
+            if (val.valueless_by_exception())
+                throw std::bad_variant_access();
+            print_alternative(os, val, std::make_index_sequence<std::variant_size_v<T> >{});
+        }
+
+        // 按 index() 选中当前的备选类型，比 std::visit 生成跳转表便宜得多
+        template<typename Os, std::size_t... Is>
+        static void print_alternative(Os &os, T const &val, std::index_sequence<Is...>) {
+            (void) ((val.index() == Is
+                         ? (_printer<std::remove_cv_t<std::variant_alternative_t<Is, T> > >::print(os, *std::get_if<Is>(&val)), true)
+                         : false) || ...);
         }
     };
 
     template<>
     struct _printer<std::nullptr_t> {
-        static void print(std::ostream &os, std::nullptr_t const &) {
+        template<typename Os>
+        static void print(Os &os, std::nullptr_t const &) {
             os << "nullptr";
         }
     };
 
     template<>
     struct _printer<std::nullopt_t> {
-        static void print(std::ostream &os, std::nullopt_t const &) {
+        template<typename Os>
+        static void print(Os &os, std::nullopt_t const &) {
             os << "nullopt";
         }
     };
 
     template<>
     struct _printer<std::monostate> {
-        static void print(std::ostream &os, std::monostate const &) {
+        template<typename Os>
+        static void print(Os &os, std::monostate const &) {
             os << "monostate";
         }
     };
 
+    template<typename Os, typename T0, typename... Ts>
+    void _print_all(Os &os, T0 const &t0, Ts const &... ts) {
+        _printer<std::remove_cvref_t<T0> >::print(os, t0);
+        ((os << ' ', _printer<std::remove_cvref_t<Ts> >::print(os, ts)), ...);
+    }
+
+    // 每个线程复用一块缓冲区，长行也不必每次分配；元素自己的 operator<< 里又调用 print 时
+    // 共享的那块正在使用，退回到一块临时缓冲区
+    class _thread_buffer {
+    public:
+        explicit _thread_buffer(_sink_ref stream = {}) noexcept : m_shared(!s_busy) {
+            if (m_shared)
+                s_busy = true;
+            else
+                m_local.emplace();
+            get().begin(get_print_options(), stream);
+        }
+
+        _thread_buffer(_thread_buffer const &) = delete;
+
+        _thread_buffer &operator=(_thread_buffer const &) = delete;
+
+        ~_thread_buffer() {
+            if (m_shared) {
+                s_buffer.trim(std::size_t(64) << 10); // 偶尔打印一次大容器，之后不必一直占着这么多内存
+                s_busy = false;
+            }
+        }
+
+        print_buffer &get() noexcept {
+            return m_shared ? s_buffer : *m_local;
+        }
+
+    private:
+        static inline thread_local print_buffer s_buffer;
+        static inline thread_local bool s_busy = false;
+
+        bool m_shared;
+        std::optional<print_buffer> m_local;
+    };
+
+    // 写到任意文件描述符，每行一次 write
+    struct fd_sink {
+        int fd;
+
+        void write(char const *p, std::size_t n) const {
+            _write_fd(fd, p, n);
+        }
+    };
+
+    // 写进调用者提供的一块内存，放不下的部分丢掉并记下 truncated
+    class span_sink {
+    public:
+        explicit span_sink(std::span<char> out) noexcept : m_out(out) {
+        }
+
+        void write(char const *p, std::size_t n) noexcept {
+            if (n > m_out.size() - m_size) {
+                n = m_out.size() - m_size;
+                m_truncated = true;
+            }
+            if (n != 0)
+                std::memcpy(m_out.data() + m_size, p, n);
+            m_size += n;
+        }
+
+        std::string_view view() const noexcept {
+            return {m_out.data(), m_size};
+        }
+
+        std::size_t size() const noexcept {
+            return m_size;
+        }
+
+        bool truncated() const noexcept {
+            return m_truncated;
+        }
+
+        void clear() noexcept {
+            m_size = 0;
+            m_truncated = false;
+        }
+
+    private:
+        std::span<char> m_out;
+        std::size_t m_size = 0;
+        bool m_truncated = false;
+    };
+
+#if defined(__unix__) || defined(__APPLE__)
+    // 直接写进内存映射的文件：先把文件扩到 reserve 字节并映射，写满时文件和映射一起扩大一倍，
+    // 所以每行只是一次 memcpy，没有 stdio 缓冲也没有系统调用；close 或析构时把文件截到实际写入的长度
+    // 不是线程安全的，多个线程写同一个文件时各自用 fd_sink 或自己加锁
+    class mmap_sink {
+    public:
+        explicit mmap_sink(char const *path, std::size_t reserve = std::size_t(1) << 20)
+            : m_fd(::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) {
+            if (m_fd == -1)
+                throw std::system_error(errno, std::system_category(), "open");
+            try {
+                remap(std::max<std::size_t>(reserve, 4096));
+            } catch (...) {
+                ::close(m_fd);
+                throw;
+            }
+        }
+
+        mmap_sink(mmap_sink const &) = delete;
+
+        mmap_sink &operator=(mmap_sink const &) = delete;
+
+        ~mmap_sink() {
+            close();
+        }
+
+        void write(char const *p, std::size_t n) {
+            if (m_fd == -1)
+                throw std::system_error(EBADF, std::system_category(), "mmap_sink closed");
+            if (m_capacity - m_size < n)
+                remap(std::max(m_capacity * 2, m_size + n));
+            std::memcpy(m_data + m_size, p, n);
+            m_size += n;
+        }
+
+        std::string_view view() const noexcept {
+            return {m_data, m_size};
+        }
+
+        std::size_t size() const noexcept {
+            return m_size;
+        }
+
+        std::size_t capacity() const noexcept {
+            return m_capacity;
+        }
+
+        void close() noexcept {
+            if (m_fd == -1)
+                return;
+            if (m_data != nullptr)
+                ::munmap(m_data, m_capacity);
+            (void) ::ftruncate(m_fd, off_t(m_size));
+            ::close(m_fd);
+            m_fd = -1;
+            m_data = nullptr;
+            m_size = 0;
+            m_capacity = 0;
+        }
+
+    private:
+        // 用 posix_fallocate 真正占下磁盘空间，磁盘满时在这里抛出 ENOSPC，而不是之后 memcpy 时收到 SIGBUS
+        // 文件系统不支持时退回 ftruncate
+        void reserve(std::size_t capacity) {
+            int error = EOPNOTSUPP;
+#if defined(__linux__)
+            error = ::posix_fallocate(m_fd, off_t(m_capacity), off_t(capacity - m_capacity));
+#endif
+            if (error == EOPNOTSUPP || error == EINVAL)
+                error = ::ftruncate(m_fd, off_t(capacity)) == -1 ? errno : 0;
+            if (error != 0)
+                throw std::system_error(error, std::system_category(), "posix_fallocate");
+        }
+
+        void remap(std::size_t capacity) {
+            reserve(capacity);
+            void *data;
+#if defined(__linux__)
+            if (m_data != nullptr)
+                data = ::mremap(m_data, m_capacity, capacity, MREMAP_MAYMOVE);
+            else
+#else
+            if (m_data != nullptr)
+                ::munmap(m_data, m_capacity);
+#endif
+                data = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+            if (data == MAP_FAILED) {
+                int error = errno;
+#if !defined(__linux__)
+                // 旧映射已经解除，已写的内容还在文件里，截好长度后关掉，之后的 write 会抛出
+                m_data = nullptr;
+                m_capacity = 0;
+                close();
+#endif
+                throw std::system_error(error, std::system_category(), "mmap");
+            }
+            m_data = static_cast<char *>(data);
+            m_capacity = capacity;
+        }
+
+        int m_fd;
+        char *m_data = nullptr;
+        std::size_t m_size = 0;
+        std::size_t m_capacity = 0;
+    };
+#endif
+
+    inline void _finish_line(_sink_ref sink, _thread_buffer &tb, bool newline) {
+        auto &buf = tb.get();
+        buf.lift_limit();
+        if (newline)
+            buf.put('\n');
+        buf.write_to(sink);
+    }
+
     template<typename T0, typename... Ts>
+    void _print_line(_sink_ref sink, bool newline, T0 const &t0, Ts const &... ts) {
+        _thread_buffer tb(sink);
+        _print_all(tb.get(), t0, ts...);
+        _finish_line(sink, tb, newline);
+    }
+
+    template<typename T0, typename... Ts> requires (!print_sink<T0>)
     void print(T0 const &t0, Ts const &... ts) {
-        [](std::ostream &os, T0 const &t0, Ts const &... ts) {
-            _printer<std::remove_cvref_t<T0> >::print(os, t0);
-            ((os << " ", _printer<std::remove_cvref_t<Ts> >::print(os, ts)), ...);
-            os << "\n";
-        }(std::cout, t0, ts...);
+        fd_sink sink{1};
+        _print_line(sink, true, t0, ts...);
     }
 
-    template<typename T0, typename... Ts>
+    template<typename T0, typename... Ts> requires (!print_sink<T0>)
     void printnl(T0 const &t0, Ts const &... ts) {
-        [](std::ostream &os, T0 const &t0, Ts const &... ts) {
-            _printer<std::remove_cvref_t<T0> >::print(os, t0);
-            ((os << " ", _printer<std::remove_cvref_t<Ts> >::print(os, ts)), ...);
-        }(std::cout, t0, ts...);
+        fd_sink sink{1};
+        _print_line(sink, false, t0, ts...);
+    }
+
+    // 打印到指定的 sink：print(fd_sink{fd}, ...)、print(mmap_sink, ...) 或任何 std::ostream
+    // span_sink 要传左值，之后才能读 size() 和 truncated()：span_sink out(buf); print(out, ...);
+    template<typename S, typename T0, typename... Ts> requires print_sink<std::remove_reference_t<S> >
+    void print(S &&sink, T0 const &t0, Ts const &... ts) {
+        _print_line(sink, true, t0, ts...);
+    }
+
+    template<typename S, typename T0, typename... Ts> requires print_sink<std::remove_reference_t<S> >
+    void printnl(S &&sink, T0 const &t0, Ts const &... ts) {
+        _print_line(sink, false, t0, ts...);
     }
 
     template<typename T0, typename... Ts>
     void eprint(T0 const &t0, Ts const &... ts) {
-        [](std::ostream &os, T0 const &t0, Ts const &... ts) {
-            _printer<std::remove_cvref_t<T0> >::print(os, t0);
-            ((os << " ", _printer<std::remove_cvref_t<Ts> >::print(os, ts)), ...);
-            os << "\n";
-        }(std::cerr, t0, ts...);
+        fd_sink sink{2};
+        _print_line(sink, true, t0, ts...);
     }
 
     template<typename T0, typename... Ts>
     void eprintnl(T0 const &t0, Ts const &... ts) {
-        [](std::ostream &os, T0 const &t0, Ts const &... ts) {
-            _printer<std::remove_cvref_t<T0> >::print(os, t0);
-            ((os << " ", _printer<std::remove_cvref_t<Ts> >::print(os, ts)), ...);
-        }(std::cerr, t0, ts...);
+        fd_sink sink{2};
+        _print_line(sink, false, t0, ts...);
     }
 
     template<typename T0, typename... Ts>
     std::string to_string(T0 const &t0, Ts const &... ts) {
-        std::ostringstream oss;
-        [](std::ostringstream &oss, T0 const &t0, Ts const &... ts) {
-            _printer<std::remove_cvref_t<T0> >::print(oss, t0);
-            ((oss << " ", _printer<std::remove_cvref_t<Ts> >::print(oss, ts)), ...);
-        }(oss, t0, ts...);
-        return oss.str();
+        _thread_buffer tb;
+        auto &buf = tb.get();
+        _print_all(buf, t0, ts...);
+        return std::string(buf.view());
+    }
+
+#if defined(__cpp_lib_format)
+    // 把 _printer 的输出直接写进 std::format 的输出迭代器，不经过中间的字符串
+    template<typename OutIt>
+    class _format_sink : public _char_sink<_format_sink<OutIt> > {
+    public:
+        explicit _format_sink(OutIt out) : m_out(std::move(out)) {
+        }
+
+        void put(char c) {
+            *m_out++ = c;
+        }
+
+        void append(char const *s, std::size_t n) {
+            m_out = std::copy_n(s, n, std::move(m_out));
+        }
+
+        void append(std::string_view s) {
+            append(s.data(), s.size());
+        }
+
+        OutIt out() {
+            return std::move(m_out);
+        }
+
+    private:
+        friend struct _char_sink<_format_sink>;
+
+        template<typename T, typename... Args>
+        void append_chars(T val, Args... args) {
+            char chars[64];
+            auto result = std::to_chars(chars, chars + sizeof(chars), val, args...);
+            append(chars, std::size_t(result.ptr - chars));
+        }
+
+        OutIt m_out;
+    };
+
+    // 标准库类型不能由我们特化 std::formatter（C++23 还自带了范围和 tuple 的格式化），
+    // 所以用一层包装：std::format("{}", printable(m)) 的输出与 print(m) 相同
+    template<typename T>
+    struct printable_ref {
+        T const &value;
+    };
+
+    template<typename T>
+    printable_ref<T> printable(T const &val) {
+        return {val};
     }
+#endif
 } // namespace printer_details
 
+#if defined(__cpp_lib_format)
+template<typename T>
+struct std::formatter<printer_details::printable_ref<T>, char> {
+    constexpr auto parse(std::format_parse_context &ctx) {
+        auto it = ctx.begin();
+        if (it != ctx.end() && *it != '}')
+            throw std::format_error("printable() does not take a format spec");
+        return it;
+    }
+
+    template<typename FormatContext>
+    auto format(printer_details::printable_ref<T> const &ref, FormatContext &ctx) const {
+        printer_details::_format_sink sink(ctx.out());
+        printer_details::_printer<std::remove_cvref_t<T> >::print(sink, ref.value);
+        return sink.out();
+    }
+};
+#endif
+
 using printer_details::print;
 using printer_details::printnl;
 using printer_details::eprint;
 using printer_details::eprintnl;
 using printer_details::to_string;
+using printer_details::print_buffer;
+using printer_details::print_options;
+using printer_details::set_print_options;
+using printer_details::get_print_options;
+using printer_details::print_sink;
+using printer_details::fd_sink;
+using printer_details::span_sink;
+#if defined(__unix__) || defined(__APPLE__)
+using printer_details::mmap_sink;
+#endif
+#if defined(__cpp_lib_format)
+using printer_details::printable;
+#endif
@@ -0,0 +1,369 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+#include "print.h"
+
+namespace printer_details {
+    // 延迟打印：调用线程只把参数的字节拷进本线程的环形缓冲区，格式化和写出交给后台线程
+    // 每条记录是 [解码函数, 记录长度] 加上参数的原始字节，解码函数按参数类型在编译期实例化，
+    // 后台线程用它把字节还原成值再交给 _printer
+    //
+    // 算术类型、枚举以及由它们组成的数组、optional、variant 原样拷贝，字符串拷贝内容，
+    // 其余类型（包括 span 这类不拥有数据的视图和带指针的结构体）在调用线程上先格式化成文本
+    // 同一线程的输出保持顺序，不同线程之间不保证；输出总是在同步的 print 之后才出现，需要时调用 flush_deferred
+
+    // 字符串和只能先格式化的值，在记录里存成 [长度, 字节]
+    struct _captured_text {
+    };
+
+    // 字节里只有值、没有指向别处的东西，后台线程晚些时候解码仍然得到同样的内容
+    template<typename T>
+    constexpr bool _by_value_v = std::is_arithmetic_v<T> || std::is_enum_v<T>;
+
+    template<typename T, std::size_t N>
+    constexpr bool _by_value_v<T[N]> = _by_value_v<T>;
+
+    template<typename T, std::size_t N>
+    constexpr bool _by_value_v<std::array<T, N> > = _by_value_v<T>;
+
+    template<typename T>
+    constexpr bool _by_value_v<std::optional<T> > = _by_value_v<T> && std::is_trivially_copyable_v<std::optional<T> >;
+
+    template<typename... Ts>
+    constexpr bool _by_value_v<std::variant<Ts...> > = (_by_value_v<Ts> && ...) &&
+                                                        std::is_trivially_copyable_v<std::variant<Ts...> >;
+
+    template<typename T>
+    using _captured_t = std::conditional_t<!std::is_convertible_v<T const &, std::string_view> && _by_value_v<T>, T,
+        _captured_text>;
+
+    using _deferred_decoder = void (*)(char const *payload, print_buffer &out);
+
+    struct _deferred_header {
+        _deferred_decoder decoder; // 为空表示这是回绕前填充的空洞
+        std::size_t size;          // 包括头部在内，16 字节对齐
+    };
+
+    static_assert(sizeof(_deferred_header) == 16);
+
+    // 单生产者单消费者的字节环：生产者是所属线程，消费者是持有 m_consume_mutex 的那个线程
+    // 记录不跨越回绕点，剩下的尾巴不够放时用一个空洞填掉
+    struct _deferred_ring {
+        static constexpr std::size_t capacity = std::size_t(1) << 20;
+
+        _deferred_ring() : data(std::make_unique_for_overwrite<char[]>(capacity)) {
+        }
+
+        std::unique_ptr<char[]> data;
+        alignas(64) std::atomic<std::uint64_t> head{0}; // 消费者写
+        alignas(64) std::atomic<std::uint64_t> tail{0}; // 生产者写
+        std::uint64_t cached_head = 0;                  // 生产者看到的 head，空间不够时才重新读
+        std::atomic<bool> closed{false};                // 所属线程已经退出，读空之后就可以丢掉
+    };
+
+    class _deferred_printer {
+    public:
+        static _deferred_printer &instance() {
+            static _deferred_printer printer;
+            return printer;
+        }
+
+        _deferred_printer(_deferred_printer const &) = delete;
+
+        _deferred_printer &operator=(_deferred_printer const &) = delete;
+
+        std::shared_ptr<_deferred_ring> attach() {
+            auto ring = std::make_shared<_deferred_ring>();
+            std::lock_guard lock(m_mutex);
+            m_rings.push_back(ring);
+            return ring;
+        }
+
+        // 把目前为止所有线程放进去的记录都格式化并写出，返回是否写出了记录
+        bool drain() {
+            std::lock_guard consume(m_consume_mutex);
+            return drain_locked();
+        }
+
+        // 生产者放进一条记录之后调用：标志已经设置时只是一次读；
+        // 否则后台线程可能在长时间睡眠，设置标志并唤醒它，每次从空闲变忙只发生一次
+        void mark_pending() {
+            if (!m_pending.load() && !m_pending.exchange(true))
+                wake();
+        }
+
+        // 生产者的环满了，马上叫后台线程腾出空间，不必等到下一个周期
+        void request_drain() {
+            m_pending.store(true);
+            wake();
+        }
+
+        // 放不进环的大记录：先写出之前的所有记录，再在同一把锁下写出这一行，
+        // 同一线程的顺序不变，后台线程的写也不会插进这一行中间
+        void write_through(print_buffer &line) {
+            std::lock_guard consume(m_consume_mutex);
+            drain_locked();
+            line.write_to(1);
+        }
+
+    private:
+        // 要在持有 m_consume_mutex 时调用
+        bool drain_locked() {
+            std::vector<std::shared_ptr<_deferred_ring> > rings;
+            {
+                std::lock_guard lock(m_mutex);
+                rings = m_rings;
+            }
+            auto options = get_print_options();
+            bool any = false;
+            for (auto &ring: rings)
+                any |= drain(*ring, options);
+            write_out();
+            std::lock_guard lock(m_mutex);
+            std::erase_if(m_rings, [](auto const &ring) {
+                return ring->closed.load(std::memory_order_acquire) &&
+                       ring->head.load(std::memory_order_relaxed) == ring->tail.load(std::memory_order_acquire);
+            });
+            return any;
+        }
+
+        _deferred_printer() : m_thread([this] { run(); }) {
+        }
+
+        ~_deferred_printer() {
+            {
+                std::lock_guard lock(m_mutex);
+                m_stop = true;
+            }
+            m_wake.notify_one();
+            m_thread.join();
+            drain();
+        }
+
+        // 有记录时每个周期攒一批写出，这期间 m_pending 一直为真，生产者不用通知，热路径上没有系统调用
+        // 读空之后清掉 m_pending 再读一遍，然后一直睡到有生产者设置标志并唤醒这里
+        // 清标志和生产者发布 tail 都是 seq_cst，两边至少有一边能看到对方：要么这里读到记录，要么生产者看到标志为空去唤醒
+        void run() {
+            std::unique_lock lock(m_mutex);
+            while (!m_stop) {
+                if (m_pending.load(std::memory_order_relaxed))
+                    m_wake.wait_for(lock, std::chrono::milliseconds(1));
+                else
+                    m_wake.wait_for(lock, std::chrono::seconds(1), [this] { return m_stop || m_pending.load(); });
+                lock.unlock();
+                if (!drain()) {
+                    m_pending.store(false);
+                    drain();
+                }
+                lock.lock();
+            }
+        }
+
+        // 先拿一下锁再通知，后台线程检查完标志、还没睡下时也不会错过
+        void wake() {
+            {
+                std::lock_guard lock(m_mutex);
+            }
+            m_wake.notify_one();
+        }
+
+        bool drain(_deferred_ring &ring, print_options const &options) {
+            std::uint64_t head = ring.head.load(std::memory_order_relaxed);
+            std::uint64_t tail = ring.tail.load(std::memory_order_seq_cst); // 与 run 里清除 m_pending 配对
+            bool any = head != tail;
+            while (head != tail) {
+                char const *record = ring.data.get() + (head & (_deferred_ring::capacity - 1));
+                _deferred_header header;
+                std::memcpy(&header, record, sizeof(header));
+                if (header.decoder != nullptr) {
+                    m_line.begin(options);
+                    header.decoder(record + sizeof(header), m_line);
+                    m_line.lift_limit();
+                    m_line.put('\n');
+                    m_out.append(m_line.view());
+                    if (m_out.size() >= (std::size_t(64) << 10))
+                        write_out();
+                }
+                head += header.size;
+                ring.head.store(head, std::memory_order_release);
+            }
+            return any;
+        }
+
+        void write_out() {
+            if (m_out.size() == 0)
+                return;
+            m_out.write_to(1);
+        }
+
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::atomic<bool> m_pending{false}; // 后台线程清空之后有没有新的记录
+        std::vector<std::shared_ptr<_deferred_ring> > m_rings;
+        bool m_stop = false;
+        std::mutex m_consume_mutex;
+        print_buffer m_line;
+        print_buffer m_out;
+        std::thread m_thread;
+    };
+
+    // 本线程的环，线程退出时标记关闭，由后台线程读空后释放
+    struct _deferred_local {
+        _deferred_local() : ring(_deferred_printer::instance().attach()) {
+        }
+
+        _deferred_local(_deferred_local const &) = delete;
+
+        _deferred_local &operator=(_deferred_local const &) = delete;
+
+        ~_deferred_local() {
+            ring->closed.store(true, std::memory_order_release);
+        }
+
+        std::shared_ptr<_deferred_ring> ring;
+    };
+
+    // 放在模板外面，所有参数组合共用同一个环，同一线程的输出才能保持顺序
+    inline _deferred_ring &_local_ring() {
+        static thread_local _deferred_local local;
+        return *local.ring;
+    }
+
+    // 只能在调用线程上先格式化成文本的类型
+    template<typename T>
+    constexpr bool _needs_text_v = std::is_same_v<_captured_t<T>, _captured_text> &&
+                                   !std::is_convertible_v<T const &, std::string_view>;
+
+    template<typename T>
+    std::size_t _captured_size(T const &val, std::string const *texts, std::size_t i) {
+        if constexpr (std::is_same_v<_captured_t<T>, _captured_text>) {
+            if constexpr (std::is_convertible_v<T const &, std::string_view>)
+                return sizeof(std::size_t) + std::string_view(val).size();
+            else
+                return sizeof(std::size_t) + texts[i].size();
+        } else {
+            return sizeof(T);
+        }
+    }
+
+    template<typename T>
+    char *_capture(char *p, T const &val, std::string const *texts, std::size_t i) {
+        if constexpr (std::is_same_v<_captured_t<T>, _captured_text>) {
+            std::string_view s;
+            if constexpr (std::is_convertible_v<T const &, std::string_view>)
+                s = std::string_view(val);
+            else
+                s = texts[i];
+            std::size_t n = s.size();
+            std::memcpy(p, &n, sizeof(n));
+            std::memcpy(p + sizeof(n), s.data(), n);
+            return p + sizeof(n) + n;
+        } else {
+            std::memcpy(p, &val, sizeof(T));
+            return p + sizeof(T);
+        }
+    }
+
+    template<typename C>
+    char const *_decode_one(char const *p, print_buffer &out) {
+        if constexpr (std::is_same_v<C, _captured_text>) {
+            std::size_t n;
+            std::memcpy(&n, p, sizeof(n));
+            out.append(p + sizeof(n), n);
+            return p + sizeof(n) + n;
+        } else {
+            alignas(C) unsigned char storage[sizeof(C)];
+            std::memcpy(storage, p, sizeof(C));
+            _printer<C>::print(out, *std::launder(reinterpret_cast<C const *>(storage)));
+            return p + sizeof(C);
+        }
+    }
+
+    // 每种参数类型组合对应一个解码函数，这就是记录里的“格式描述”
+    template<typename C0, typename... Cs>
+    void _deferred_decode(char const *p, print_buffer &out) {
+        p = _decode_one<C0>(p, out);
+        ((out.put(' '), p = _decode_one<Cs>(p, out)), ...);
+    }
+
+    template<typename T>
+    std::string _deferred_text(T const &val) {
+        if constexpr (_needs_text_v<T>)
+            return to_string(val);
+        else
+            return {};
+    }
+
+    template<typename T0, typename... Ts>
+    void _print_deferred(std::string const *texts, T0 const &t0, Ts const &... ts) {
+        std::size_t payload = 0;
+        {
+            std::size_t i = 0;
+            payload += _captured_size(t0, texts, i++);
+            ((payload += _captured_size(ts, texts, i++)), ...);
+        }
+        std::size_t size = (sizeof(_deferred_header) + payload + 15) & ~std::size_t(15);
+        constexpr std::size_t capacity = _deferred_ring::capacity;
+        if (size > capacity / 4) [[unlikely]] { // 太大的记录不值得占用环形缓冲区
+            _thread_buffer tb;
+            auto &line = tb.get();
+            _print_all(line, t0, ts...);
+            line.lift_limit();
+            line.put('\n');
+            _deferred_printer::instance().write_through(line);
+            return;
+        }
+
+        auto &ring = _local_ring();
+        std::uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+        std::size_t index = tail & (capacity - 1);
+        std::size_t contiguous = capacity - index;
+        std::size_t reserve = size <= contiguous ? size : contiguous + size;
+        // 缓冲区满了就叫醒后台线程，等它腾出空间，宁可慢下来也不丢日志
+        while (capacity - (tail - ring.cached_head) < reserve) {
+            ring.cached_head = ring.head.load(std::memory_order_acquire);
+            if (capacity - (tail - ring.cached_head) < reserve) {
+                _deferred_printer::instance().request_drain();
+                std::this_thread::yield();
+            }
+        }
+        char *data = ring.data.get();
+        if (size > contiguous) {
+            _deferred_header hole{nullptr, contiguous};
+            std::memcpy(data + index, &hole, sizeof(hole));
+            tail += contiguous;
+            index = 0;
+        }
+        _deferred_header header{&_deferred_decode<_captured_t<T0>, _captured_t<Ts>...>, size};
+        std::memcpy(data + index, &header, sizeof(header));
+        char *p = data + index + sizeof(header);
+        std::size_t i = 0;
+        p = _capture(p, t0, texts, i++);
+        ((p = _capture(p, ts, texts, i++)), ...);
+        ring.tail.store(tail + size, std::memory_order_seq_cst);
+        _deferred_printer::instance().mark_pending();
+    }
+
+    template<typename T0, typename... Ts>
+    void print_deferred(T0 const &t0, Ts const &... ts) {
+        if constexpr (_needs_text_v<T0> || (_needs_text_v<Ts> || ...)) {
+            std::string const texts[] = {_deferred_text(t0), _deferred_text(ts)...};
+            _print_deferred(texts, t0, ts...);
+        } else {
+            _print_deferred(nullptr, t0, ts...);
+        }
+    }
+
+    inline void flush_deferred() {
+        _deferred_printer::instance().drain();
+    }
+} // namespace printer_details
+
+using printer_details::print_deferred;
+using printer_details::flush_deferred;
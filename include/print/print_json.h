@@ -0,0 +1,234 @@
+#pragma once
+
+#include <cmath>
+#include "print.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace printer_details {
+    // 按 JSON 规则转义后追加到 buf：引号、反斜杠和控制字符需要转义，其余字节（包括 UTF-8）原样照抄
+    // 有 SSE2 时一次检查 16 个字节，没有需要转义的字符就整块拷贝
+    inline void _json_escape(print_buffer &buf, std::string_view s) {
+        static constexpr char hex[] = "0123456789abcdef";
+        char const *p = s.data();
+        char const *end = p + s.size();
+        char const *run = p; // 还没拷贝出去的一段不需要转义的字节
+        auto escape = [&](char c) {
+            buf.append(run, std::size_t(p - run));
+            switch (c) {
+                case '"': buf.append("\\\"", 2); break;
+                case '\\': buf.append("\\\\", 2); break;
+                case '\b': buf.append("\\b", 2); break;
+                case '\f': buf.append("\\f", 2); break;
+                case '\n': buf.append("\\n", 2); break;
+                case '\r': buf.append("\\r", 2); break;
+                case '\t': buf.append("\\t", 2); break;
+                default: {
+                    char u[6] = {'\\', 'u', '0', '0', hex[(unsigned char) c >> 4], hex[c & 0xf]};
+                    buf.append(u, 6);
+                }
+            }
+            run = ++p;
+        };
+#if defined(__SSE2__)
+        __m128i const quote = _mm_set1_epi8('"');
+        __m128i const backslash = _mm_set1_epi8('\\');
+        __m128i const control = _mm_set1_epi8(0x1f);
+        while (end - p >= 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+            __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                                           _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control)); // 无符号 <= 0x1f
+            unsigned mask = unsigned(_mm_movemask_epi8(special));
+            if (mask == 0) {
+                p += 16;
+                continue;
+            }
+            p += __builtin_ctz(mask);
+            escape(*p);
+        }
+#endif
+        while (p != end) {
+            unsigned char c = (unsigned char) *p;
+            if (c < 0x20 || c == '"' || c == '\\')
+                escape(*p);
+            else
+                ++p;
+        }
+        buf.append(run, std::size_t(p - run));
+    }
+
+    inline void _json_string(print_buffer &buf, std::string_view s) {
+        buf.put('"');
+        _json_escape(buf, s);
+        buf.put('"');
+    }
+
+    // 与 _printer 相同的分派：map 是对象，可迭代对象和 tuple 是数组，optional 为空时是 null，
+    // variant 取当前的值；其余类型用 print 的格式输出成字符串
+    template<typename T>
+    struct _json_printer {
+        static void print(print_buffer &buf, T const &val) {
+            _thread_buffer tb;
+            tb.get().begin(print_options{});
+            _printer<T>::print(tb.get(), val);
+            _json_string(buf, tb.get().view());
+        }
+    };
+
+    template<>
+    struct _json_printer<bool> {
+        static void print(print_buffer &buf, bool val) {
+            buf.append(val ? std::string_view("true") : std::string_view("false"));
+        }
+    };
+
+    template<typename T> requires std::is_arithmetic_v<T> && (!std::is_same_v<T, bool>) && (!is_char<T>)
+    struct _json_printer<T> {
+        static void print(print_buffer &buf, T val) {
+            if constexpr (std::is_floating_point_v<T>) {
+                if (!std::isfinite(val)) { // NaN 和无穷大在 JSON 里没有表示
+                    buf.append("null", 4);
+                    return;
+                }
+            }
+            char chars[64];
+            auto result = std::to_chars(chars, chars + sizeof(chars), val); // 浮点取最短的可以精确还原的表示
+            buf.append(chars, std::size_t(result.ptr - chars));
+        }
+    };
+
+    template<typename T> requires is_char<T>
+    struct _json_printer<T> {
+        static void print(print_buffer &buf, T const &val) {
+            static_assert(std::is_same_v<T, char>, "only char is supported in JSON output");
+            _json_string(buf, std::string_view(&val, 1));
+        }
+    };
+
+    template<typename T> requires is_string<T> || is_c_str<T>
+    struct _json_printer<T> {
+        static void print(print_buffer &buf, T const &val) {
+            static_assert(std::is_convertible_v<T const &, std::string_view>, "only char strings are supported in JSON output");
+            _json_string(buf, std::string_view(val));
+        }
+    };
+
+    template<typename T> requires is_tuple<T> && (!is_array<T>)
+    struct _json_printer<T> {
+        static void print(print_buffer &buf, T const &val) {
+            buf.put('[');
+            print_elements(buf, val, std::make_index_sequence<std::tuple_size_v<T> >{});
+            buf.put(']');
+        }
+
+        template<std::size_t... Is>
+        static void print_elements(print_buffer &buf, T const &val, std::index_sequence<Is...>) {
+            ((Is != 0 ? buf.put(',') : void(), _json_printer<std::remove_cvref_t<std::tuple_element_t<Is, T> > >::print(buf, std::get<Is>(val))),
+                ...);
+        }
+    };
+
+    template<typename T> requires is_iterable<T> && (!is_map<T>) && (!is_c_str<T>) && (!is_string<T>)
+    struct _json_printer<T> {
+        static void print(print_buffer &buf, T const &val) {
+            buf.put('[');
+            bool once = false;
+            for (auto const &v: val) {
+                if (once) buf.put(',');
+                once = true;
+                _json_printer<std::remove_cvref_t<decltype(v)> >::print(buf, v);
+            }
+            buf.put(']');
+        }
+    };
+
+    // 对象的键必须是字符串，其他类型的键按 print 的格式转成字符串
+    template<typename T> requires is_map<T>
+    struct _json_printer<T> {
+        static void print(print_buffer &buf, T const &val) {
+            using key_type = typename T::key_type;
+            buf.put('{');
+            bool once = false;
+            for (auto const &[k, v]: val) {
+                if (once) buf.put(',');
+                once = true;
+                if constexpr (is_string<key_type> || is_c_str<key_type>) {
+                    _json_string(buf, std::string_view(k));
+                } else {
+                    _thread_buffer tb;
+                    tb.get().begin(print_options{});
+                    _printer<key_type>::print(tb.get(), k);
+                    _json_string(buf, tb.get().view());
+                }
+                buf.put(':');
+                _json_printer<typename T::mapped_type>::print(buf, v);
+            }
+            buf.put('}');
+        }
+    };
+
+    template<typename T> requires is_optional<T>
+    struct _json_printer<T> {
+        static void print(print_buffer &buf, T const &val) {
+            if (val.has_value()) {
+                _json_printer<typename T::value_type>::print(buf, val.value());
+            } else {
+                buf.append("null", 4);
+            }
+        }
+    };
+
+    template<typename T> requires is_variant<T>
+    struct _json_printer<T> {
+        static void print(print_buffer &buf, T const &val) {
+            if (val.valueless_by_exception())
+                throw std::bad_variant_access();
+            print_alternative(buf, val, std::make_index_sequence<std::variant_size_v<T> >{});
+        }
+
+        template<std::size_t... Is>
+        static void print_alternative(print_buffer &buf, T const &val, std::index_sequence<Is...>) {
+            (void) ((val.index() == Is
+                         ? (_json_printer<std::remove_cv_t<std::variant_alternative_t<Is, T> > >::print(buf, *std::get_if<Is>(&val)), true)
+                         : false) || ...);
+        }
+    };
+
+    template<typename T> requires is_one_of<T, std::nullptr_t, std::nullopt_t, std::monostate>
+    struct _json_printer<T> {
+        static void print(print_buffer &buf, T const &) {
+            buf.append("null", 4);
+        }
+    };
+
+    // 追加到调用者自己的缓冲区，热路径上反复序列化时可以一直复用同一块内存
+    template<typename T>
+    void append_json(print_buffer &buf, T const &val) {
+        _json_printer<std::remove_cvref_t<T> >::print(buf, val);
+    }
+
+    // JSON 必须完整，不受 print_options 的截断限制
+    template<typename T>
+    std::string to_json(T const &val) {
+        _thread_buffer tb;
+        auto &buf = tb.get();
+        buf.begin(print_options{});
+        append_json(buf, val);
+        return std::string(buf.view());
+    }
+
+    template<typename T>
+    void print_json(T const &val) {
+        _thread_buffer tb;
+        auto &buf = tb.get();
+        buf.begin(print_options{});
+        append_json(buf, val);
+        buf.put('\n');
+        buf.write_to(1);
+    }
+} // namespace printer_details
+
+using printer_details::append_json;
+using printer_details::to_json;
+using printer_details::print_json;
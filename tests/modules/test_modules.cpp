@@ -0,0 +1,23 @@
+// 只用 import 的使用方，检查模块导出了常用的名字；只在 LIBRARY_BUILD_MODULES 打开时构建
+import print;
+import debugger;
+import demangle;
+
+#include <map>
+#include <string>
+#include <vector>
+
+int main() {
+    std::map<std::string, std::vector<int> > m{{"a", {1, 2}}, {"b", {}}};
+    print(m, 'x', 1.5);
+    print(to_string(m) == "{a: [1, 2], b: []}");
+    char out[16];
+    span_sink span{out};
+    print(span, "hello");
+    print(span.view() == "hello\n");
+    print_json(m);
+    print_deferred("deferred", 42);
+    flush_deferred();
+    debug(), m;
+    print(demangle<int const &>());
+}
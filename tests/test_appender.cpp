@@ -0,0 +1,36 @@
+#include <coro.h>
+#include <appender.h>
+#include <fstream>
+#include <sstream>
+#include <print.h>
+
+Task<void> producer(FileAppender &appender, int id, int count) {
+    for (int i = 0; i < count; ++i)
+        co_await appender.append("producer " + std::to_string(id) + " record " + std::to_string(i) + "\n");
+}
+
+Task<void> test_appender(char const *path) {
+    FileAppender appender(path);
+    std::vector<Task<void> > producers;
+    for (int id = 0; id < 50; ++id)
+        producers.push_back(producer(appender, id, 20));
+    co_await when_all(producers);
+
+    // 1000 条记录远少于 1000 次 fsync
+    print(appender.bytesWritten(), appender.syncCount() < 100, appender.writeCount() == appender.syncCount());
+
+    std::ifstream file(path);
+    std::size_t lines = 0;
+    for (std::string line; std::getline(file, line);)
+        ++lines;
+    print(lines);
+}
+
+int main() {
+    char path[] = "/tmp/test_appender_XXXXXX";
+    ::close(::mkstemp(path));
+    auto t = test_appender(path);
+    getLoop().run(t);
+    ::unlink(path);
+    t.mCoroutine.promise().result();
+}
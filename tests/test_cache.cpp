@@ -0,0 +1,55 @@
+#include <cache.h>
+#include <print.h>
+#include <string>
+#include <vector>
+
+int loadCount = 0;
+
+Task<std::string> loadFromStore(int key) {
+    ++loadCount;
+    co_await sleep_for(5ms);
+    if (key < 0)
+        throw std::runtime_error("no such key");
+    co_return "value" + std::to_string(key);
+}
+
+Task<std::string> request(AsyncCache<int, std::string> &cache, int key) {
+    co_return co_await cache.get(key, loadFromStore);
+}
+
+Task<void> test_cache() {
+    AsyncCache<int, std::string> cache(2, 50ms);
+
+    std::vector<Task<std::string> > burst;
+    for (int i = 0; i < 10; ++i)
+        burst.push_back(request(cache, 1));
+    auto values = co_await when_all(burst);
+    print(values.front(), values.size(), loadCount);
+
+    co_await cache.get(2, loadFromStore);
+    co_await cache.get(1, loadFromStore);
+    co_await cache.get(3, loadFromStore);
+    print(cache.size(), loadCount);
+    co_await cache.get(2, loadFromStore);
+    print(loadCount);
+
+    co_await sleep_for(80ms);
+    print(cache.size());
+    co_await cache.get(1, loadFromStore);
+    print(loadCount);
+
+    for (int i = 0; i < 2; ++i) {
+        try {
+            co_await cache.get(-1, loadFromStore);
+        } catch (std::runtime_error const &e) {
+            print(e.what(), loadCount);
+        }
+    }
+    print(cache.hits(), cache.misses());
+}
+
+int main() {
+    auto t = test_cache();
+    getLoop().run(t);
+    t.mCoroutine.promise().result();
+}
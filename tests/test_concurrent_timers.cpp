@@ -0,0 +1,95 @@
+#include <coro.h>
+#include <print.h>
+#include <thread_pool.h>
+#include <memory>
+#include <random>
+#include <vector>
+
+constexpr int kThreads = 4;
+constexpr int kTimersPerThread = 2000;
+
+Task<void> test_concurrent_timers() {
+    auto &loop = getLoop();
+    auto loopThread = std::this_thread::get_id();
+    auto timers = std::make_unique<ConcurrentTimer[]>(kThreads * kTimersPerThread);
+    int fired = 0;
+    bool onLoopThread = true;
+
+    // 多个线程同时设置定时器，再随机取消一部分，回调里检查确实在 Loop 线程上执行
+    auto cancelled = co_await offload(getThreadPool(), [&] {
+        std::atomic<int> cancelled{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t) {
+            threads.emplace_back([&, t] {
+                std::mt19937 rng(static_cast<unsigned>(t));
+                for (int i = 0; i < kTimersPerThread; ++i) {
+                    auto &timer = timers[t * kTimersPerThread + i];
+                    auto expireTime = std::chrono::system_clock::now() + std::chrono::microseconds(rng() % 20000);
+                    loop.armTimer(timer, expireTime, [&] {
+                        onLoopThread = onLoopThread && std::this_thread::get_id() == loopThread;
+                        ++fired;
+                    });
+                    if (rng() % 2 == 0 && timer.cancel())
+                        cancelled.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+        for (auto &thread: threads)
+            thread.join();
+        return cancelled.load();
+    });
+
+    while (loop.mTimerStore.size() != 0)
+        co_await sleep_for(1ms);
+    print(fired + cancelled == kThreads * kTimersPerThread, cancelled > 0, onLoopThread);
+
+    // 其他线程设置一个比 Loop 正在等待的定时器更早的定时器，Loop 要被叫醒而不是睡到原来的时间
+    ConcurrentTimer early;
+    auto start = std::chrono::steady_clock::now();
+    auto firedAt = start + 1h;
+    std::thread arming([&] {
+        std::this_thread::sleep_for(50ms);
+        loop.armTimer(early, std::chrono::system_clock::now() + 10ms,
+                      [&] { firedAt = std::chrono::steady_clock::now(); });
+    });
+    co_await sleep_for(500ms);
+    arming.join();
+    print(firedAt - start < 300ms);
+
+    // Loop 手上没有别的定时器、正无限期地等着 offload 回来时，其他线程设置的定时器也要能叫醒它；
+    // 第二个定时器在第一个快要触发时才设置，反复撞上 Loop 从触发回调到重新入睡之间的窗口
+    auto missed = co_await offload(getThreadPool(), [&] {
+        int missed = 0;
+        for (int i = 0; i < 200; ++i) {
+            ConcurrentTimer first, second;
+            std::atomic<bool> done{false};
+            auto firstTime = std::chrono::system_clock::now() + 200us;
+            loop.armTimer(first, firstTime, [] {});
+            while (std::chrono::system_clock::now() < firstTime - std::chrono::microseconds(i % 8 * 10))
+                std::this_thread::yield();
+            loop.armTimer(second, std::chrono::system_clock::now() + 100us,
+                          [&] { done.store(true, std::memory_order_release); });
+            auto deadline = std::chrono::steady_clock::now() + 1s;
+            while (!done.load(std::memory_order_acquire) && std::chrono::steady_clock::now() < deadline)
+                std::this_thread::yield();
+            if (!done.load(std::memory_order_acquire))
+                ++missed;
+        }
+        return missed;
+    });
+    print(missed);
+
+    // 析构时自动取消
+    {
+        ConcurrentTimer scoped;
+        loop.armTimer(scoped, std::chrono::system_clock::now() + 1h, [] {});
+        print(scoped.armed(), loop.mTimerStore.size());
+    }
+    print(loop.mTimerStore.size());
+}
+
+int main() {
+    auto t = test_concurrent_timers();
+    getLoop().run(t);
+    t.mCoroutine.promise().result();
+}
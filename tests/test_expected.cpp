@@ -0,0 +1,65 @@
+#include <expected_task.h>
+#include <print.h>
+#include <string>
+
+enum class Errc {
+    kOverloaded,
+    kNotFound,
+};
+
+std::ostream &operator<<(std::ostream &os, Errc e) {
+    return os << (e == Errc::kOverloaded ? "overloaded" : "not found");
+}
+
+int stepsAfterFailure = 0;
+
+Task<std::expected<int, Errc> > lookup(int key) {
+    co_await sleep_for(std::chrono::milliseconds(key));
+    if (key % 2)
+        co_return std::unexpected(Errc::kNotFound);
+    co_return key * 10;
+}
+
+Task<std::expected<void, Errc> > admit(bool overloaded) {
+    if (overloaded)
+        co_return std::unexpected(Errc::kOverloaded);
+    co_return {};
+}
+
+Task<std::expected<std::string, Errc> > handle(int key, bool overloaded) {
+    co_await try_await(admit(overloaded));
+    int value = co_await try_await(lookup(key));
+    ++stepsAfterFailure;
+    co_return std::to_string(value);
+}
+
+Task<std::expected<std::string, Errc> > outer(int key) {
+    auto s = co_await try_await(handle(key, false));
+    co_return "<" + s + ">";
+}
+
+Task<void> test_expected() {
+    auto ok = co_await handle(2, false);
+    print(ok.value());
+    auto notFound = co_await handle(3, false);
+    print(notFound.error(), stepsAfterFailure);
+    auto overloaded = co_await handle(2, true);
+    print(overloaded.error(), stepsAfterFailure);
+    print((co_await outer(4)).value(), (co_await outer(5)).error());
+
+    auto all = co_await when_all(lookup(2), lookup(4), admit(false));
+    print(std::get<0>(*all), std::get<1>(*all));
+    auto failed = co_await when_all(lookup(20), lookup(1), lookup(4));
+    print(failed.error());
+
+    auto any = co_await when_any(lookup(8), lookup(2));
+    print(any->index(), std::get<1>(*any));
+    auto anyFailed = co_await when_any(lookup(8), lookup(3));
+    print(anyFailed.error());
+}
+
+int main() {
+    auto t = test_expected();
+    getLoop().run(t);
+    t.mCoroutine.promise().result();
+}
@@ -0,0 +1,38 @@
+#define CORO_PROFILE_FRAMES 1
+
+#include <coro.h>
+#include <print.h>
+#include <array>
+#include <sstream>
+
+Task<int> small(int x) {
+    co_return x + 1;
+}
+
+Task<int> large(int x) {
+    std::array<char, 1024> buffer{};
+    buffer[x % buffer.size()] = char(x);
+    co_await sleep_for(1ms);
+    co_return buffer[x % buffer.size()];
+}
+
+Task<int> driver() {
+    int sum = 0;
+    for (int i = 0; i < 10; ++i)
+        sum += co_await small(i);
+    for (int i = 0; i < 3; ++i)
+        sum += co_await large(i);
+    auto [a, b] = co_await when_all(small(1), large(2));
+    co_return sum + a + b;
+}
+
+int main() {
+    {
+        auto t = driver();
+        getLoop().run(t);
+        print(t.mCoroutine.promise().result());
+    }
+    std::ostringstream report;
+    FrameProfiler::instance().report(report);
+    std::cout << report.str();
+}
@@ -0,0 +1,72 @@
+#include <pairing_heap.h>
+#include <dary_heap.h>
+#include <memory>
+#include <random>
+#include <set>
+#include <vector>
+#include <print.h>
+
+template <template <class> class Container>
+struct Item : Container<Item<Container>>::Node {
+    explicit Item(int key) : mKey(key) {}
+
+    int mKey;
+
+    friend bool operator<(Item const &lhs, Item const &rhs) noexcept {
+        return lhs.mKey < rhs.mKey;
+    }
+};
+
+template <class T>
+using Pairing = PairingHeap<T>;
+
+template <class T>
+using Binary = DaryHeap<T, std::less<T>, 2>;
+
+template <class T>
+using Quaternary = DaryHeap<T, std::less<T>, 4>;
+
+// 随机插入、删除任意节点、弹出最小值，与 std::multiset 对照
+template <template <class> class Container>
+void test_random() {
+    std::mt19937 rng(42);
+    Container<Item<Container>> heap;
+    std::vector<std::unique_ptr<Item<Container>>> items;
+    std::multiset<int> expected;
+    bool ok = true;
+    for (int step = 0; step < 20000; ++step) {
+        unsigned action = rng() % 4;
+        if (items.empty() || action < 2) {
+            int key = int(rng() % 1000);
+            heap.insert(*items.emplace_back(std::make_unique<Item<Container>>(key)));
+            expected.insert(key);
+        } else {
+            std::size_t index = rng() % items.size();
+            if (action == 3) {
+                // 弹出最小值：找到它在 items 里的位置
+                auto &front = heap.front();
+                for (index = 0; items[index].get() != &front; ++index) {}
+            }
+            expected.erase(expected.find(items[index]->mKey));
+            if (rng() % 2)
+                heap.erase(*items[index]);
+            std::swap(items[index], items.back());
+            items.pop_back(); // 没有显式 erase 的节点在析构时自动摘下
+        }
+        ok = ok && heap.size() == expected.size();
+        ok = ok && (heap.empty() ? expected.empty() : heap.front().mKey == *expected.begin());
+    }
+    std::vector<int> drained;
+    while (!heap.empty()) {
+        drained.push_back(heap.front().mKey);
+        heap.erase(heap.front());
+    }
+    ok = ok && std::ranges::equal(drained, expected);
+    print(ok, drained.size());
+}
+
+int main() {
+    test_random<Pairing>();
+    test_random<Binary>();
+    test_random<Quaternary>();
+}
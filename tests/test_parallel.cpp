@@ -0,0 +1,42 @@
+#include <parallel.h>
+#include <print.h>
+#include <random>
+#include <vector>
+
+Task<void> test_parallel() {
+    std::vector<double> v(1'000'000);
+    co_await parallel_for(std::views::iota(std::size_t(0), v.size()), 10000,
+                          [&](std::size_t i) { v[i] = double(i % 1000); });
+    print(v[0], v[999], v[1000], v[999999]);
+
+    co_await parallel_for(v, 10000, [](double &x) { x *= 2; });
+    double sum = co_await parallel_reduce(v, 10000, 0.0);
+    print(sum);
+
+    long maxValue = co_await parallel_reduce(std::views::iota(0L, 12345L), 100, -1L,
+                                             [](long a, long b) { return std::max(a, b); });
+    print(maxValue);
+
+    std::vector<int> w(1'000'003);
+    std::mt19937 rng(42);
+    for (auto &x: w)
+        x = int(rng() % 100000);
+    co_await parallel_sort(w);
+    print(std::is_sorted(w.begin(), w.end()));
+    co_await parallel_sort(w, std::greater<>());
+    print(std::is_sorted(w.begin(), w.end(), std::greater<>()));
+
+    try {
+        co_await parallel_for(std::views::iota(0, 100), 1, [](int i) {
+            if (i == 42) throw std::runtime_error("chunk failed");
+        });
+    } catch (std::runtime_error const &e) {
+        print(e.what());
+    }
+}
+
+int main() {
+    auto t = test_parallel();
+    getLoop().run(t);
+    t.mCoroutine.promise().result();
+}
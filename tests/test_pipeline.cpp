@@ -0,0 +1,47 @@
+#include <pipeline.h>
+#include <print.h>
+#include <string>
+#include <vector>
+
+Task<void> test_pipeline(ThreadPool &pool) {
+    std::vector<int> input;
+    for (int i = 1; i <= 20; ++i)
+        input.push_back(i);
+
+    std::vector<std::vector<int> > batches;
+    co_await (from(input)
+              | map([](int x) { return x * x; })
+              | filter([](int x) { return x % 2 == 1; })
+              | batch(4).buffer(2)
+              | sink([&](std::vector<int> b) { batches.push_back(std::move(b)); }));
+    print(batches);
+
+    int n = 0;
+    long sum = 0;
+    co_await (generate([&]() -> std::optional<int> {
+                  if (n == 1000) return std::nullopt;
+                  return n++;
+              })
+              | map([](int x) { return std::to_string(x); }, pool, 8)
+              | map([](std::string const &s) { return (long) std::stol(s); })
+              | sink([&](long x) { sum += x; }));
+    print(sum);
+
+    try {
+        co_await (from(input)
+                  | map([](int x) {
+                      if (x == 5) throw std::runtime_error("boom");
+                      return x;
+                  })
+                  | sink([](int) {}));
+    } catch (std::runtime_error const &e) {
+        print(e.what());
+    }
+}
+
+int main() {
+    ThreadPool pool(4);
+    auto t = test_pipeline(pool);
+    getLoop().run(t);
+    t.mCoroutine.promise().result();
+}
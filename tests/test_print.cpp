@@ -1,6 +1,6 @@
 #include <array>
-#include <format>
 #include <print.h>
+#include <stdexcept>
 #include <unordered_map>
 #include <vector>
 
@@ -29,6 +29,66 @@ int main() {
     print(a);
     double arr[5] = {1.1, 2.3, 3.8, 4.9, 5.10};
     print(arr);
+#if defined(__cpp_lib_format)
     auto str = std::format("hello world: {}", to_string(um));
     std::cout << str << std::endl;
+    std::cout << std::format("hello world: {}", printable(um)) << std::endl;
+    std::cout << std::format("{} {}", printable(m), printable(t)) << std::endl;
+#else
+    std::cout << "hello world: " << to_string(um) << std::endl;
+#endif
+
+    std::vector<std::vector<int> > nested{{1, 2, 3, 4}, {5, 6}, {7}, {8, 9, 10}};
+    std::map<int, std::vector<std::vector<int> > > deep{{1, nested}, {2, {}}};
+    set_print_options({.max_elements = 3});
+    print(nested, a);
+    set_print_options({.max_depth = 2});
+    print(deep, t);
+    set_print_options({.max_bytes = 20});
+    print(nested);
+    print(to_string(std::vector<int>(5'000'000, 7)).size());
+    set_print_options({.chunk_size = 64});
+    print(std::vector<int>(100, 1));
+    set_print_options({});
+    print(nested);
+
+    char out[32];
+    span_sink span{out};
+    print(span, nested);
+    printnl(span, t);
+    print(span.view(), span.size(), span.truncated());
+    print(fd_sink{1}, m, 'x');
+    print(std::cout, vec);
+    {
+        mmap_sink file("test_print_mmap.txt", 16);
+        for (int i = 0; i < 100; ++i)
+            print(file, i, nested);
+        print(file.size(), file.capacity() >= file.size(), file.view().substr(0, 30));
+        // close 之后再写要抛出，而不是往已经解除的映射里 memcpy
+        file.close();
+        try {
+            print(file, "again");
+        } catch (std::system_error const &e) {
+            print(e.code() == std::errc::bad_file_descriptor, file.view().empty());
+        }
+    }
+    // 截断时追加 ... 也可能把已有内容交给 sink，sink 抛出的异常要能传到调用者；
+    // 600 字节的字符串让缓冲区正好扩到 600，截到 599 后放不下 ...，这时才第一次交给 sink
+    struct failing_sink {
+        void write(char const *, std::size_t) {
+            throw std::runtime_error("sink full");
+        }
+    } failing;
+    set_print_options({.max_bytes = 599, .chunk_size = 16});
+    try {
+        print(failing, std::string(600, 'x'));
+    } catch (std::runtime_error const &e) {
+        print(e.what());
+    }
+    set_print_options({});
+    std::FILE *file = std::fopen("test_print_mmap.txt", "r");
+    std::fseek(file, 0, SEEK_END);
+    print(std::ftell(file));
+    std::fclose(file);
+    std::remove("test_print_mmap.txt");
 }
@@ -0,0 +1,112 @@
+#include <print_deferred.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <span>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct Pod {
+    int a;
+    double b;
+
+    friend std::ostream &operator<<(std::ostream &os, Pod const &p) {
+        return os << "Pod{" << p.a << ", " << p.b << "}";
+    }
+};
+
+// 把标准输出临时重定向到文件，运行 f 之后把写进去的内容读回来
+template<typename F>
+std::string capture_stdout(F f) {
+    std::fflush(stdout);
+    std::FILE *file = std::tmpfile();
+    int saved = dup(1);
+    dup2(fileno(file), 1);
+    f();
+    flush_deferred();
+    dup2(saved, 1);
+    close(saved);
+    std::string text;
+    std::rewind(file);
+    char chunk[4096];
+    while (std::size_t n = std::fread(chunk, 1, sizeof(chunk), file))
+        text.append(chunk, n);
+    std::fclose(file);
+    return text;
+}
+
+int main() {
+    std::string owned = "owned string";
+    print_deferred("hello", 42, 2.5, 'c', true);
+    print_deferred(owned, std::string_view("view"), Pod{1, 0.5});
+    print_deferred(std::vector<int>{1, 2, 3}, std::optional<int>(), std::pair(1, 2.5));
+    owned = "changed"; // 已经拷贝进环里，后面修改不影响输出
+    flush_deferred();
+
+    // 多个线程同时打印，每一行都要完整，同一线程内保持顺序
+    constexpr int kThreads = 8, kLines = 20000;
+    auto text = capture_stdout([] {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t)
+            threads.emplace_back([t] {
+                for (int i = 0; i < kLines; ++i)
+                    print_deferred("thread", t, "line", i, std::string(std::size_t(i % 50), 'x'));
+            });
+        for (auto &thread: threads)
+            thread.join();
+    });
+    std::vector<int> next(kThreads, 0);
+    bool ok = true;
+    std::istringstream lines(text);
+    std::string word;
+    int t, i;
+    std::string rest;
+    std::size_t count = 0;
+    while (lines >> word >> t >> word >> i) {
+        std::getline(lines, rest);
+        ok = ok && t >= 0 && t < kThreads && next[t] == i && rest == " " + std::string(std::size_t(i % 50), 'x');
+        next[t] = i + 1;
+        ++count;
+    }
+    print(ok, count == std::size_t(kThreads * kLines));
+
+    // span 这类视图在调用时就格式化成文本，之后修改或释放底层数据不影响输出
+    std::vector<int> viewed{1, 2, 3};
+    print_deferred(std::span<int>(viewed), std::array<int, 2>{4, 5}, std::optional<double>(0.5));
+    viewed.assign(1000, 7);
+    flush_deferred();
+
+    // 放不进环的大记录（比环的四分之一大）与同一线程前后的小记录保持顺序
+    constexpr std::size_t kBig = std::size_t(1) << 19;
+    text = capture_stdout([] {
+        std::string big(kBig, 'b');
+        for (int i = 0; i < 3; ++i) {
+            print_deferred("small", i);
+            print_deferred(big);
+        }
+    });
+    std::string expected;
+    for (int i = 0; i < 3; ++i)
+        expected += "small " + std::to_string(i) + "\n" + std::string(kBig, 'b') + "\n";
+    print(text == expected);
+
+    // 后台线程空闲时长时间睡眠（1 秒），新记录要把它叫醒，不调用 flush_deferred 也要很快写出
+    std::fflush(stdout);
+    std::FILE *file = std::tmpfile();
+    int saved = dup(1);
+    dup2(fileno(file), 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    print_deferred("wake", 1);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+    struct stat st{};
+    while (fstat(fileno(file), &st) == 0 && st.st_size == 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    dup2(saved, 1);
+    close(saved);
+    std::fclose(file);
+    print(st.st_size == 7);
+}
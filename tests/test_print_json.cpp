@@ -0,0 +1,69 @@
+#include <print_json.h>
+#include <limits>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+// 逐字节的参考实现，用来对照 SIMD 版本
+std::string escape_reference(std::string_view s) {
+    std::string out = "\"";
+    for (char c: s) {
+        unsigned char u = (unsigned char) c;
+        if (c == '"') out += "\\\"";
+        else if (c == '\\') out += "\\\\";
+        else if (c == '\b') out += "\\b";
+        else if (c == '\f') out += "\\f";
+        else if (c == '\n') out += "\\n";
+        else if (c == '\r') out += "\\r";
+        else if (c == '\t') out += "\\t";
+        else if (u < 0x20) {
+            char u6[7];
+            std::snprintf(u6, sizeof(u6), "\\u%04x", u);
+            out += u6;
+        } else out += c;
+    }
+    return out + "\"";
+}
+
+struct Point {
+    int x, y;
+
+    friend std::ostream &operator<<(std::ostream &os, Point const &p) {
+        return os << "Point(" << p.x << ", " << p.y << ")";
+    }
+};
+
+int main() {
+    std::map<std::string, std::variant<int, double, std::string> > m{
+        {"hello", 2.1}, {"world", 4}, {"quote\"d", "line\nbreak"}
+    };
+    print_json(m);
+    std::vector<std::optional<int> > vec{1, 2, std::nullopt, 4, 5};
+    print_json(vec);
+    std::tuple<int, double, std::string, bool, char> t{1, 0.1, "tab\there", true, 'c'};
+    print_json(t);
+    std::map<int, std::vector<std::pair<int, std::string> > > nested{{1, {{2, "a"}, {3, "b"}}}, {4, {}}};
+    print_json(nested);
+    print_json(std::vector<double>{1e300 * 1e300, std::numeric_limits<double>::quiet_NaN(), -0.5, 1e-7, 123456789.0});
+    print_json(std::tuple{nullptr, std::nullopt, std::monostate{}, Point{3, 4}, "c\\str"});
+    print_json(std::string("\x01\x1f\x7f caf\xc3\xa9"));
+
+    // 随机字符串里混入需要转义的字符，覆盖 16 字节分块边界前后的各种位置
+    std::mt19937 rng(1);
+    bool ok = true;
+    for (int i = 0; i < 2000; ++i) {
+        std::string s(rng() % 80, 'x');
+        for (auto &c: s) {
+            unsigned r = rng() % 100;
+            c = r < 5 ? char(rng() % 0x20) : r < 8 ? '"' : r < 10 ? '\\' : r < 15 ? char(0x80 + rng() % 0x80) : char('a' + rng() % 26);
+        }
+        ok = ok && to_json(s) == escape_reference(s);
+    }
+    print(ok);
+
+    print_buffer buf;
+    append_json(buf, std::unordered_map<std::string, int>{{"k", 1}});
+    buf.put(' ');
+    append_json(buf, std::vector<int>{});
+    print(buf.view());
+}
@@ -0,0 +1,38 @@
+#include <coro.h>
+#include <process.h>
+#include <print.h>
+
+Task<void> test_process() {
+    std::vector<std::string> argv{"sh", "-c", "echo hello; echo oops >&2; exit 3"};
+    auto process = co_await spawn_process(argv);
+    auto [out, err, status] = co_await when_all(
+        process.readAllStdout(), process.readAllStderr(), process.wait());
+    print(out, err, WIFEXITED(status), WEXITSTATUS(status));
+
+    // 多个子进程并发运行，总耗时接近最慢的一个而不是总和
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Process> children;
+    argv = {"sh", "-c", "sleep 0.2; echo done"};
+    for (int i = 0; i < 4; ++i)
+        children.push_back(co_await spawn_process(argv));
+    std::vector<Task<std::string> > outputs;
+    for (auto &child: children)
+        outputs.push_back(child.readAllStdout());
+    auto results = co_await when_all(outputs);
+    for (auto &child: children)
+        co_await child.wait();
+    print(results, std::chrono::steady_clock::now() - start < 600ms);
+
+    try {
+        argv = {"/nonexistent/program"};
+        co_await spawn_process(argv);
+    } catch (std::system_error const &e) {
+        print(e.code() == std::errc::no_such_file_or_directory);
+    }
+}
+
+int main() {
+    auto t = test_process();
+    getLoop().run(t);
+    t.mCoroutine.promise().result();
+}
@@ -0,0 +1,336 @@
+#include <rbtree.h>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <ranges>
+#include <set>
+#include <vector>
+#include <print.h>
+
+template <class Policy = RbWideNode>
+struct Item : RbTree<Item<Policy>, std::less<>, Policy>::RbNode {
+    explicit Item(int key) : mKey(key) {}
+
+    int mKey;
+
+    friend bool operator<(Item const &lhs, Item const &rhs) noexcept {
+        return lhs.mKey < rhs.mKey;
+    }
+
+    friend bool operator<(Item const &lhs, int rhs) noexcept {
+        return lhs.mKey < rhs;
+    }
+
+    friend bool operator<(int lhs, Item const &rhs) noexcept {
+        return lhs < rhs.mKey;
+    }
+};
+
+using Tree = RbTree<Item<>, std::less<>>;
+static_assert(std::bidirectional_iterator<Tree::iterator>);
+static_assert(std::bidirectional_iterator<Tree::const_iterator>);
+
+template <class Tree>
+std::vector<int> keys(Tree const &tree) {
+    std::vector<int> result;
+    for (auto const &item: tree)
+        result.push_back(item.mKey);
+    return result;
+}
+
+void test_basic() {
+    Tree tree;
+    std::vector<std::unique_ptr<Item<>>> items;
+    for (int key: {5, 3, 8, 3, 1, 9, 7})
+        tree.insert(*items.emplace_back(std::make_unique<Item<>>(key)));
+    print(keys(tree), tree.size(), tree.front().mKey, tree.back().mKey);
+
+    std::vector<int> reversed;
+    for (auto it = tree.end(); it != tree.begin();)
+        reversed.push_back((--it)->mKey);
+    print(reversed);
+
+    print(tree.find(7)->mKey, tree.find(4) == tree.end());
+    print(tree.lower_bound(3)->mKey, std::distance(tree.begin(), tree.lower_bound(3)));
+    print(tree.upper_bound(3)->mKey, std::distance(tree.begin(), tree.upper_bound(3)));
+    print(tree.upper_bound(9) == tree.end());
+
+    // 节点析构时自动从树里摘掉
+    items[5].reset();
+    items[4].reset();
+    print(keys(tree), tree.size(), tree.front().mKey, tree.back().mKey);
+
+    for (auto it = tree.begin(); it != tree.end();)
+        it = it->mKey == 3 ? tree.erase(it) : std::next(it);
+    print(keys(tree));
+}
+
+template <class Policy>
+void test_random() {
+    std::mt19937 rng(42);
+    RbTree<Item<Policy>, std::less<>, Policy> tree;
+    std::vector<std::unique_ptr<Item<Policy>>> items;
+    std::multiset<int> expected;
+    bool ok = true;
+    for (int step = 0; step < 20000; ++step) {
+        if (items.empty() || rng() % 3 != 0) {
+            int key = int(rng() % 1000);
+            tree.insert(*items.emplace_back(std::make_unique<Item<Policy>>(key)));
+            expected.insert(key);
+        } else {
+            std::size_t index = rng() % items.size();
+            expected.erase(expected.find(items[index]->mKey));
+            tree.erase(*items[index]);
+            std::swap(items[index], items.back());
+            items.pop_back();
+        }
+        if (step % 100 == 0)
+            ok = ok && tree.validate();
+        if (tree.size() != expected.size()) {
+            ok = false;
+        } else if (!expected.empty()) {
+            int key = int(rng() % 1000);
+            auto lower = expected.lower_bound(key);
+            auto upper = expected.upper_bound(key);
+            ok = ok && tree.front().mKey == *expected.begin() && tree.back().mKey == *expected.rbegin();
+            ok = ok && (tree.lower_bound(key) == tree.end() ? lower == expected.end() : tree.lower_bound(key)->mKey == *lower);
+            ok = ok && (tree.upper_bound(key) == tree.end() ? upper == expected.end() : tree.upper_bound(key)->mKey == *upper);
+        }
+    }
+    ok = ok && std::ranges::equal(keys(tree), expected);
+    print(ok, tree.size());
+}
+
+// 每一步操作之后都检查红黑性质并与 std::multiset 逐个元素对照，键的范围很小以制造大量重复；
+// 先增长后收缩，两个阶段的删除都会走到 doErase 的各种情形。失败时打印第一个出错的步数
+template <class Policy>
+void test_property() {
+    using Tree = RbTree<Item<Policy>, std::less<>, Policy>;
+    std::mt19937 rng(11);
+    Tree tree;
+    std::vector<std::unique_ptr<Item<Policy>>> items;
+    std::multiset<int> expected;
+    auto eraseItem = [&](Item<Policy> &item) {
+        expected.erase(expected.find(item.mKey));
+        auto it = std::ranges::find_if(items, [&](auto &p) { return p.get() == &item; });
+        std::swap(*it, items.back());
+        items.pop_back();
+    };
+    int firstFailure = -1;
+    for (int step = 0; step < 40000 && firstFailure == -1; ++step) {
+        bool growing = step % 4000 < 2500;
+        unsigned op = rng() % 8;
+        if (items.empty() || (growing ? op < 4 : op < 2)) {
+            int key = int(rng() % 64);
+            tree.insert(*items.emplace_back(std::make_unique<Item<Policy>>(key)));
+            expected.insert(key);
+        } else if (op < 5) {
+            std::size_t index = rng() % items.size();
+            tree.erase(*items[index]);
+            expected.erase(expected.find(items[index]->mKey));
+            std::swap(items[index], items.back());
+            items.pop_back();
+        } else if (op == 5) {
+            auto &item = rng() % 2 ? tree.front() : tree.back();
+            tree.erase(item);
+            eraseItem(item);
+        } else if (op == 6) {
+            auto it = tree.lower_bound(int(rng() % 64));
+            if (it != tree.end()) {
+                auto &item = *it;
+                tree.erase(it);
+                eraseItem(item);
+            }
+        } else {
+            Tree lower;
+            tree.split(int(rng() % 64), lower);
+            if (!tree.validate() || !lower.validate())
+                firstFailure = step;
+            lower.join(tree);
+            tree.merge(lower);
+        }
+        if (!tree.validate() || !std::ranges::equal(keys(tree), expected))
+            firstFailure = step;
+    }
+    print(firstFailure, tree.size());
+}
+
+template <class Policy>
+void test_bulk() {
+    using Tree = RbTree<Item<Policy>, std::less<>, Policy>;
+    std::mt19937 rng(7);
+    std::vector<std::unique_ptr<Item<Policy>>> storage;
+    auto makeSorted = [&](std::size_t n, int lo, int hi) {
+        std::vector<int> keys;
+        for (std::size_t i = 0; i < n; ++i)
+            keys.push_back(lo + int(rng() % unsigned(hi - lo)));
+        std::ranges::sort(keys);
+        std::vector<Item<Policy> *> items;
+        for (int key: keys)
+            items.push_back(storage.emplace_back(std::make_unique<Item<Policy>>(key)).get());
+        return items;
+    };
+    auto deref = std::views::transform([](Item<Policy> *item) -> Item<Policy> & { return *item; });
+    bool ok = true;
+
+    // 空树上线性建树，再分别并入少量和大量有序元素
+    Tree tree;
+    std::multiset<int> expected;
+    for (std::size_t n: {0, 1, 2, 3, 1000, 5, 3000}) {
+        auto items = makeSorted(n, 0, 10000);
+        tree.insertSorted(items | deref);
+        for (auto *item: items)
+            expected.insert(item->mKey);
+        ok = ok && tree.validate() && std::ranges::equal(keys(tree), expected);
+    }
+
+    // 在不同位置 split 再 join 回去
+    for (int key: {-1, 0, 17, 5000, 9999, 10000}) {
+        Tree lower;
+        tree.split(key, lower);
+        ok = ok && tree.validate() && lower.validate();
+        ok = ok && lower.size() == std::size_t(std::distance(expected.begin(), expected.upper_bound(key)));
+        ok = ok && (lower.empty() || lower.back().mKey <= key) && (tree.empty() || tree.front().mKey > key);
+        lower.join(tree);
+        ok = ok && tree.empty() && tree.validate() && lower.validate();
+        tree.merge(lower);
+        ok = ok && lower.empty() && tree.validate() && std::ranges::equal(keys(tree), expected);
+    }
+
+    // 值域不重叠（两个方向）与重叠的 merge
+    for (auto [lo, hi]: {std::pair{20000, 30000}, std::pair{-10000, -5000}, std::pair{-20000, 40000}}) {
+        Tree other;
+        auto items = makeSorted(500, lo, hi);
+        other.insertSorted(items | deref);
+        for (auto *item: items)
+            expected.insert(item->mKey);
+        tree.merge(other);
+        ok = ok && other.empty() && tree.validate() && std::ranges::equal(keys(tree), expected);
+    }
+    print(ok, tree.size());
+
+    while (!tree.empty())
+        tree.erase(tree.front());
+}
+
+struct Ranked : RbTree<Ranked, std::less<>, RbWideNode, RbSubtreeSize>::RbNode {
+    explicit Ranked(int key) : mKey(key) {}
+
+    int mKey;
+
+    friend bool operator<(Ranked const &lhs, Ranked const &rhs) noexcept {
+        return lhs.mKey < rhs.mKey;
+    }
+
+    friend bool operator<(Ranked const &lhs, int rhs) noexcept {
+        return lhs.mKey < rhs;
+    }
+
+    friend bool operator<(int lhs, Ranked const &rhs) noexcept {
+        return lhs < rhs.mKey;
+    }
+};
+
+struct Interval : RbTree<Interval, std::less<>, RbPackedNode, RbMaxEnd<int>>::RbNode {
+    Interval(int low, int high) : mLow(low), mHigh(high) {}
+
+    int low() const noexcept {
+        return mLow;
+    }
+
+    int high() const noexcept {
+        return mHigh;
+    }
+
+    int mLow;
+    int mHigh;
+
+    friend bool operator<(Interval const &lhs, Interval const &rhs) noexcept {
+        return lhs.mLow < rhs.mLow;
+    }
+};
+
+// 随机插入删除后 rank/select 与排好序的数组对照，聚合值经过旋转和批量操作都要正确
+void test_order_statistics() {
+    std::mt19937 rng(3);
+    RbTree<Ranked, std::less<>, RbWideNode, RbSubtreeSize> tree;
+    // merge 之后节点都挂在 lower 上，lower 要比 items 活得久，节点析构时才能从一棵活着的树上摘下来
+    RbTree<Ranked, std::less<>, RbWideNode, RbSubtreeSize> lower;
+    std::vector<std::unique_ptr<Ranked>> items;
+    bool ok = true;
+    for (int step = 0; step < 5000; ++step) {
+        if (items.empty() || rng() % 3 != 0) {
+            tree.insert(*items.emplace_back(std::make_unique<Ranked>(int(rng() % 1000))));
+        } else {
+            std::swap(items[rng() % items.size()], items.back());
+            items.pop_back();
+        }
+        if (step % 50 == 0) {
+            ok = ok && tree.validate();
+            std::size_t index = 0;
+            for (auto &item: tree)
+                ok = ok && tree.rank(item) == index && &*tree.select(index++) == &item;
+            ok = ok && tree.select(index) == tree.end();
+        }
+    }
+
+    tree.split(500, lower);
+    ok = ok && tree.validate() && lower.validate();
+    ok = ok && RbTree<Ranked, std::less<>, RbWideNode, RbSubtreeSize>::augmentOf(*lower.select(0)) <= lower.size();
+    lower.merge(tree);
+    ok = ok && lower.validate() && lower.size() == items.size();
+    std::size_t median = lower.size() / 2;
+    print(ok, lower.select(median)->mKey == std::next(lower.begin(), std::ptrdiff_t(median))->mKey);
+}
+
+void test_interval() {
+    std::mt19937 rng(5);
+    RbTree<Interval, std::less<>, RbPackedNode, RbMaxEnd<int>> tree;
+    std::vector<std::unique_ptr<Interval>> items;
+    bool ok = true;
+    for (int step = 0; step < 3000; ++step) {
+        if (items.empty() || rng() % 4 != 0) {
+            int low = int(rng() % 10000);
+            tree.insert(*items.emplace_back(std::make_unique<Interval>(low, low + int(rng() % 300))));
+        } else {
+            std::size_t index = rng() % items.size();
+            tree.erase(*items[index]);
+            std::swap(items[index], items.back());
+            items.pop_back();
+        }
+        if (step % 30 == 0) {
+            ok = ok && tree.validate();
+            int low = int(rng() % 10000);
+            int high = low + int(rng() % 100);
+            std::size_t expected = 0;
+            for (auto &item: items)
+                expected += item->mLow <= high && low <= item->mHigh;
+            std::size_t visited = 0;
+            int lastLow = -1;
+            tree.forEachOverlap(low, high, [&](Interval &item) {
+                ok = ok && item.mLow <= high && low <= item.mHigh && item.mLow >= lastLow;
+                lastLow = item.mLow;
+                ++visited;
+            });
+            auto any = tree.findOverlap(low, high);
+            ok = ok && visited == expected && (any == tree.end()) == (expected == 0);
+        }
+    }
+    print(ok, tree.size());
+}
+
+int main() {
+    test_basic();
+    test_random<RbWideNode>();
+    test_random<RbPackedNode>();
+    test_random<RbCompactNode>();
+    test_property<RbWideNode>();
+    test_property<RbPackedNode>();
+    test_property<RbCompactNode>();
+    test_bulk<RbWideNode>();
+    test_bulk<RbPackedNode>();
+    test_bulk<RbCompactNode>();
+    test_order_statistics();
+    test_interval();
+    print(sizeof(Item<RbWideNode>), sizeof(Item<RbPackedNode>), sizeof(Item<RbCompactNode>));
+}
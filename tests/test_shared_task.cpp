@@ -0,0 +1,51 @@
+#include <shared_task.h>
+#include <print.h>
+#include <string>
+#include <vector>
+
+int computeCount = 0;
+
+SharedTask<std::string> expensive() {
+    ++computeCount;
+    co_await sleep_for(10ms);
+    co_return std::string("expensive result");
+}
+
+SharedTask<int> failing() {
+    co_await sleep_for(1ms);
+    throw std::runtime_error("failed once");
+    co_return 0;
+}
+
+Task<std::size_t> request(SharedTask<std::string> shared, int id) {
+    co_await sleep_for(std::chrono::milliseconds(id));
+    std::string const &value = co_await shared;
+    co_return value.size();
+}
+
+Task<void> test_shared_task() {
+    SharedTask<std::string> shared = expensive();
+    std::vector<Task<std::size_t> > requests;
+    for (int i = 0; i < 5; ++i)
+        requests.push_back(request(shared, i));
+    auto sizes = co_await when_all(requests);
+    print(sizes);
+    print(computeCount);
+    print(co_await shared);
+    print(computeCount);
+
+    SharedTask<int> fail = failing();
+    for (int i = 0; i < 2; ++i) {
+        try {
+            co_await fail;
+        } catch (std::runtime_error const &e) {
+            print(e.what());
+        }
+    }
+}
+
+int main() {
+    auto t = test_shared_task();
+    getLoop().run(t);
+    t.mCoroutine.promise().result();
+}
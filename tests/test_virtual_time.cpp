@@ -0,0 +1,46 @@
+#include <coro.h>
+#include <print.h>
+
+int attempts = 0;
+
+Task<bool> flakyCall() {
+    co_await sleep_for(200ms);
+    co_return ++attempts == 12;
+}
+
+Task<int> retryWithBackoff() {
+    auto backoff = std::chrono::system_clock::duration(1s);
+    while (!co_await flakyCall()) {
+        co_await sleep_for(backoff);
+        backoff *= 2;
+    }
+    co_return attempts;
+}
+
+Task<int> ticker(std::chrono::system_clock::duration period, int count) {
+    for (int i = 0; i < count; ++i)
+        co_await sleep_for(period);
+    co_return count;
+}
+
+Task<void> test_virtual_time() {
+    auto &loop = getLoop();
+    auto start = loop.now();
+    auto n = co_await retryWithBackoff();
+    auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(loop.now() - start);
+    print(n, elapsed.count());
+
+    start = loop.now();
+    auto [a, b] = co_await when_all(ticker(1h, 24), ticker(90min, 10));
+    elapsed = std::chrono::duration_cast<std::chrono::seconds>(loop.now() - start);
+    print(a, b, elapsed.count());
+}
+
+int main() {
+    auto wallStart = std::chrono::steady_clock::now();
+    getLoop().setVirtualTime(std::chrono::system_clock::time_point{});
+    auto t = test_virtual_time();
+    getLoop().run(t);
+    t.mCoroutine.promise().result();
+    print(std::chrono::steady_clock::now() - wallStart < 1s);
+}